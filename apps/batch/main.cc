@@ -0,0 +1,497 @@
+#include "../../src/util/hash.hh"
+#include "boot.hh"
+#include "bus.hh"
+#include "cpu/cpu.hh"
+#include "pool.hh"
+#include "util/loglevel.hh"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// NOLINTBEGIN
+
+// Runs a manifest of ROMs, each in an emulator of its own, on a pool of
+// threads and writes what came of every one of them to a single JSON summary.
+//
+// The manifest has a ROM on each line followed by what to do with it:
+//
+//   # rom [frames=<n> | cycles=<n>] [input=<script>] [name=<name>]
+//   roms/game.gba frames=3600 input=game.keys
+//
+// An input script has a frame number on each line and the keys held from that
+// frame on, joined by + or none:
+//
+//   120 start
+//   130 none
+//   200 a+right
+//
+// Paths are taken relative to the file they are written in. With --boot
+// snapshot, every ROM runs the BIOS once and later runs start from where it
+// left off, from the cache.
+//
+// The emulator throws where it cannot go on with a ROM, so a ROM that does
+// what no game should only fails its own task.
+
+namespace {
+struct Task {
+    std::string name;
+    std::string rom;
+    uint64_t frames = 0;
+    uint64_t cycles = 0;
+    std::string input;
+};
+
+struct Result {
+    bool ok = false;
+    std::string error;
+    size_t thread                = 0;
+    uint64_t frames              = 0;
+    matar::RunStats stats        = {};
+    std::chrono::nanoseconds setup{ 0 };
+    std::vector<uint64_t> hashes = {};
+};
+
+// keys held from a frame on
+struct KeyChange {
+    uint64_t frame;
+    uint16_t keys;
+};
+
+// hashes every frame the way matar --hash-log does
+class HashSink : public matar::display::FrameSink {
+  public:
+    explicit HashSink(std::vector<uint64_t>& hashes)
+      : hashes(hashes) {}
+
+    void consume(const matar::display::Frame& frame) override {
+        hashes.push_back(hash::xxh64(frame.pixels));
+    }
+
+  private:
+    std::vector<uint64_t>& hashes;
+};
+
+std::string
+resolve(const std::filesystem::path& from, const std::string& path) {
+    std::filesystem::path resolved(path);
+
+    if (resolved.is_relative())
+        resolved = from.parent_path() / resolved;
+
+    return resolved.string();
+}
+
+std::vector<Task>
+read_manifest(const std::string& path) {
+    std::ifstream file(path);
+
+    if (!file.is_open())
+        throw std::ios::failure("Could not open " + path, std::error_code());
+
+    std::vector<Task> tasks;
+    std::string line;
+    uint64_t number = 0;
+
+    while (std::getline(file, line)) {
+        number++;
+
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string field;
+        Task task;
+
+        if (!(fields >> task.rom))
+            continue;
+
+        auto fail = [&]() {
+            throw std::invalid_argument(
+              path + ":" + std::to_string(number) + ": bad field " + field);
+        };
+
+        while (fields >> field) {
+            auto equals = field.find('=');
+
+            if (equals == std::string::npos)
+                fail();
+
+            std::string key = field.substr(0, equals);
+            std::string val = field.substr(equals + 1);
+
+            try {
+                if (key == "frames")
+                    task.frames = std::stoull(val);
+                else if (key == "cycles")
+                    task.cycles = std::stoull(val);
+                else if (key == "input")
+                    task.input = resolve(path, val);
+                else if (key == "name")
+                    task.name = val;
+                else
+                    fail();
+            } catch (const std::logic_error&) {
+                fail();
+            }
+        }
+
+        if ((task.frames == 0) == (task.cycles == 0)) {
+            throw std::invalid_argument(
+              path + ":" + std::to_string(number) +
+              ": one of frames or cycles has to be given");
+        }
+
+        if (task.name.empty())
+            task.name = task.rom;
+
+        task.rom = resolve(path, task.rom);
+        tasks.push_back(std::move(task));
+    }
+
+    return tasks;
+}
+
+std::vector<KeyChange>
+read_input(const std::string& path) {
+    static constexpr std::array<const char*, 10> KEYS = {
+        "a", "b", "select", "start", "right", "left", "up", "down", "r", "l"
+    };
+
+    std::ifstream file(path);
+
+    if (!file.is_open())
+        throw std::ios::failure("Could not open " + path, std::error_code());
+
+    std::vector<KeyChange> changes;
+    std::string line;
+
+    while (std::getline(file, line)) {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        KeyChange change = {};
+        std::string keys;
+
+        if (!(fields >> change.frame))
+            continue;
+
+        if (!(fields >> keys))
+            throw std::invalid_argument(path + ": no keys for frame " +
+                                        std::to_string(change.frame));
+
+        std::istringstream names(keys);
+        std::string name;
+
+        while (std::getline(names, name, '+')) {
+            if (name == "none")
+                continue;
+
+            auto key = std::find(KEYS.begin(), KEYS.end(), name);
+
+            if (key == KEYS.end())
+                throw std::invalid_argument(path + ": unknown key " + name);
+
+            change.keys |= 1 << (key - KEYS.begin());
+        }
+
+        changes.push_back(change);
+    }
+
+    std::stable_sort(
+      changes.begin(), changes.end(), [](const auto& a, const auto& b) {
+          return a.frame < b.frame;
+      });
+
+    return changes;
+}
+
+// fills in the result as it goes, so that a task that fails midway still
+// says how far it got
+void
+run_task(const Task& task,
+         const std::array<uint8_t, matar::Bus::BIOS_SIZE>& bios,
+         matar::BootMode boot,
+         const std::filesystem::path& boot_cache,
+         Result& result) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<KeyChange> input;
+
+    if (!task.input.empty())
+        input = read_input(task.input);
+
+    std::ifstream file(task.rom, std::ios::in | std::ios::binary);
+
+    if (!file.is_open())
+        throw std::ios::failure("Could not open " + task.rom,
+                                std::error_code());
+
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+
+    auto bios_copy = bios;
+    matar::Bus bus(std::move(bios_copy), std::move(rom));
+    matar::Cpu cpu(bus);
+    HashSink sink(result.hashes);
+
+    /* the BIOS is not hashed, it is the same for every ROM */
+    matar::boot(bus, cpu, boot, boot_cache);
+    bus.set_frame_sink(&sink);
+
+    result.setup = std::chrono::steady_clock::now() - start;
+
+    auto change = input.begin();
+    const uint64_t end =
+      task.cycles > 0 ? bus.get_cycles() + task.cycles : UINT64_MAX;
+
+    while (task.frames > 0 ? result.frames < task.frames
+                           : bus.get_cycles() < end) {
+        while (change != input.end() && change->frame <= result.frames) {
+            bus.set_keys(change->keys);
+            change++;
+        }
+
+        const uint64_t frame = bus.frame_count();
+        auto stats           = bus.run_until([&bus, frame, end]() {
+            return bus.frame_count() != frame || bus.get_cycles() >= end;
+        });
+
+        result.stats.cycles += stats.cycles;
+        result.stats.instructions += stats.instructions;
+        result.stats.events += stats.events;
+        result.stats.host_time += stats.host_time;
+
+        if (bus.frame_count() != frame)
+            result.frames++;
+    }
+
+    result.ok = true;
+}
+
+std::string
+quote(const std::string& string) {
+    std::string quoted = "\"";
+
+    for (char c : string) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            quoted += std::format("\\u{:04x}", static_cast<int>(c));
+        } else {
+            quoted += c;
+        }
+    }
+
+    return quoted + "\"";
+}
+
+void
+write_result(std::ostream& out, const Task& task, const Result& result) {
+    auto seconds = [](std::chrono::nanoseconds time) {
+        return std::chrono::duration<double>(time).count();
+    };
+
+    const double host_seconds = seconds(result.stats.host_time);
+
+    /* the hashes of all frames folded into one, to compare runs at a
+     * glance */
+    uint64_t combined = 0;
+
+    for (uint64_t h : result.hashes)
+        combined = hash::combine(combined, h);
+
+    out << "    {\"name\": " << quote(task.name)
+        << ", \"rom\": " << quote(task.rom)
+        << ", \"status\": " << (result.ok ? "\"ok\"" : "\"failed\"");
+
+    if (!result.ok)
+        out << ", \"error\": " << quote(result.error);
+
+    out << ", \"thread\": " << result.thread
+        << ", \"frames\": " << result.frames
+        << ", \"cycles\": " << result.stats.cycles
+        << ", \"instructions\": " << result.stats.instructions
+        << ", \"events\": " << result.stats.events
+        << ", \"setup_seconds\": " << seconds(result.setup)
+        << ", \"host_seconds\": " << host_seconds << ", \"fps\": "
+        << (host_seconds > 0 ? result.frames / host_seconds : 0)
+        << ", \"mips\": "
+        << (host_seconds > 0
+              ? result.stats.instructions / host_seconds / 1e6
+              : 0)
+        << ", \"hash\": \"" << std::format("{:016x}", combined)
+        << "\", \"frame_hashes\": [";
+
+    for (size_t i = 0; i < result.hashes.size(); i++) {
+        out << (i > 0 ? ", " : "")
+            << std::format("\"{:016x}\"", result.hashes[i]);
+    }
+
+    out << "]}";
+}
+}
+
+int
+main(int argc, const char* argv[]) {
+    auto usage = [argv]() {
+        std::cerr << "Usage: " << argv[0]
+                  << " <manifest> [-b <bios>] [-j <threads>]"
+                  << " [-o <summary.json>]"
+                  << " [--boot <bios | direct | snapshot>]"
+                  << " [--boot-cache <dir>]" << std::endl;
+        std::exit(2);
+    };
+
+    std::string manifest, bios_file = "gba_bios.bin", summary_file;
+    uint32_t threads = std::thread::hardware_concurrency();
+    matar::BootMode boot = matar::BootMode::Bios;
+    std::filesystem::path boot_cache;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "-b") {
+            if (++i < argc)
+                bios_file = argv[i];
+            else
+                usage();
+        } else if (arg == "-j") {
+            if (++i >= argc)
+                usage();
+
+            try {
+                threads = std::stoul(argv[i]);
+            } catch (const std::logic_error&) {
+                usage();
+            }
+        } else if (arg == "-o") {
+            if (++i < argc)
+                summary_file = argv[i];
+            else
+                usage();
+        } else if (arg == "--boot") {
+            if (++i >= argc)
+                usage();
+
+            try {
+                boot = matar::parse_boot_mode(argv[i]);
+            } catch (const std::invalid_argument&) {
+                usage();
+            }
+        } else if (arg == "--boot-cache") {
+            if (++i < argc)
+                boot_cache = argv[i];
+            else
+                usage();
+        } else if (manifest.empty()) {
+            manifest = arg;
+        } else {
+            usage();
+        }
+    }
+
+    if (manifest.empty())
+        usage();
+
+    // the logger is shared by every emulator, and would slow them all down
+    matar::set_log_level(matar::LogLevel::Off);
+
+    std::vector<Task> tasks;
+    std::array<uint8_t, matar::Bus::BIOS_SIZE> bios = { 0 };
+
+    try {
+        tasks = read_manifest(manifest);
+
+        if (boot_cache.empty())
+            boot_cache = matar::default_boot_cache();
+
+        std::ifstream ifile(bios_file, std::ios::in | std::ios::binary);
+
+        if (!ifile.is_open())
+            throw std::ios::failure("BIOS file not found", std::error_code());
+
+        ifile.seekg(0, std::ios::end);
+
+        if (ifile.tellg() != matar::Bus::BIOS_SIZE)
+            throw std::ios::failure("BIOS file has invalid size",
+                                    std::error_code());
+
+        ifile.seekg(0, std::ios::beg);
+        ifile.read(reinterpret_cast<char*>(bios.data()), bios.size());
+    } catch (const std::exception& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return 2;
+    }
+
+    std::vector<Result> results(tasks.size());
+    WorkStealingPool pool(std::min<size_t>(threads, tasks.size()));
+    std::mutex progress;
+    size_t done = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    pool.run(tasks.size(), [&](size_t index, size_t thread) {
+        Result& result = results[index];
+
+        /* a failed ROM is reported and leaves the others be */
+        try {
+            run_task(tasks[index], bios, boot, boot_cache, result);
+        } catch (const std::exception& e) {
+            result.ok    = false;
+            result.error = e.what();
+        }
+
+        result.thread = thread;
+
+        std::lock_guard guard(progress);
+        std::cerr << "[" << ++done << "/" << tasks.size() << "] "
+                  << tasks[index].name << ": "
+                  << (result.ok ? "ok" : "failed, " + result.error)
+                  << std::endl;
+    });
+
+    std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    size_t failed = std::count_if(results.begin(),
+                                  results.end(),
+                                  [](const Result& r) { return !r.ok; });
+
+    std::ofstream summary;
+
+    if (!summary_file.empty()) {
+        summary.open(summary_file);
+
+        if (!summary.is_open()) {
+            std::cerr << "Could not open " << summary_file << std::endl;
+            return 2;
+        }
+    }
+
+    std::ostream& out = summary_file.empty() ? std::cout : summary;
+
+    out << "{\n  \"manifest\": " << quote(manifest)
+        << ",\n  \"threads\": " << pool.size()
+        << ",\n  \"tasks\": " << tasks.size()
+        << ",\n  \"failed\": " << failed
+        << ",\n  \"host_seconds\": " << elapsed.count()
+        << ",\n  \"results\": [\n";
+
+    for (size_t i = 0; i < tasks.size(); i++) {
+        write_result(out, tasks[i], results[i]);
+        out << (i + 1 < tasks.size() ? ",\n" : "\n");
+    }
+
+    out << "  ]\n}" << std::endl;
+
+    return failed > 0 ? 1 : 0;
+}
+
+// NOLINTEND
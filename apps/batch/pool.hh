@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Runs jobs on a fixed number of threads. The jobs are dealt out to the
+// threads up front, each thread works through its own from the back and once
+// it runs out takes jobs from the front of the others, so that a few long jobs
+// landing on one thread do not hold up the rest.
+class WorkStealingPool {
+  public:
+    explicit WorkStealingPool(uint32_t threads)
+      : queues(std::max<uint32_t>(threads, 1)) {}
+
+    size_t size() const { return queues.size(); }
+
+    // calls job(index, thread) for every index below count, on as many
+    // threads as the pool has, and returns once all of them are done
+    void run(size_t count, const std::function<void(size_t, size_t)>& job) {
+        for (size_t index = 0; index < count; index++) {
+            queues[index % queues.size()].jobs.push_back(index);
+        }
+
+        std::vector<std::thread> threads;
+
+        for (size_t thread = 0; thread < queues.size(); thread++) {
+            threads.emplace_back([this, thread, &job]() {
+                while (auto index = next(thread)) {
+                    job(*index, thread);
+                }
+            });
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+  private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<size_t> jobs;
+    };
+
+    std::vector<Queue> queues;
+
+    /* jobs are only ever dealt out before the threads start, so once every
+     * queue has been found empty there is nothing left to wait for */
+    std::optional<size_t> next(size_t thread) {
+        for (size_t i = 0; i < queues.size(); i++) {
+            Queue& queue = queues[(thread + i) % queues.size()];
+            std::lock_guard guard(queue.lock);
+
+            if (queue.jobs.empty()) {
+                continue;
+            }
+
+            size_t index;
+
+            if (i == 0) {
+                index = queue.jobs.back();
+                queue.jobs.pop_back();
+            } else {
+                index = queue.jobs.front();
+                queue.jobs.pop_front();
+            }
+
+            return index;
+        }
+
+        return std::nullopt;
+    }
+};
@@ -0,0 +1,102 @@
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+
+// NOLINTBEGIN
+
+// Compares two frame hash logs written by matar --hash-log and reports the
+// first frame where they part ways. Exits with 0 if they match, 1 if they do
+// not and 2 if they could not be read.
+
+namespace {
+struct Entry {
+    uint64_t frame;
+    std::string pixels;
+    std::string audio;
+};
+
+std::optional<Entry>
+next_entry(std::ifstream& log) {
+    std::string line;
+
+    while (std::getline(log, line)) {
+        std::istringstream fields(line);
+        Entry entry;
+
+        if (fields >> entry.frame >> entry.pixels) {
+            fields >> entry.audio;
+            return entry;
+        }
+    }
+
+    return std::nullopt;
+}
+}
+
+int
+main(int argc, const char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <expected log> <actual log>"
+                  << std::endl;
+        return 2;
+    }
+
+    std::ifstream expected(argv[1]), actual(argv[2]);
+
+    if (!expected.is_open() || !actual.is_open()) {
+        std::cerr << "Could not open "
+                  << (expected.is_open() ? argv[2] : argv[1]) << std::endl;
+        return 2;
+    }
+
+    uint64_t matched = 0;
+
+    while (true) {
+        auto want = next_entry(expected);
+        auto got  = next_entry(actual);
+
+        if (!want && !got) {
+            std::cout << matched << " frames match" << std::endl;
+            return 0;
+        }
+
+        if (!want || !got) {
+            std::cout << (want ? argv[2] : argv[1]) << " ends after "
+                      << matched << " frames, "
+                      << (want ? argv[1] : argv[2]) << " goes on to frame "
+                      << (want ? want->frame : got->frame) << std::endl;
+            return 1;
+        }
+
+        if (want->frame != got->frame) {
+            std::cout << "frame numbers differ after " << matched
+                      << " matching frames (" << want->frame
+                      << " != " << got->frame << "), were frames skipped?"
+                      << std::endl;
+            return 1;
+        }
+
+        if (want->pixels != got->pixels) {
+            std::cout << "frame " << want->frame << ": pixels differ ("
+                      << want->pixels << " != " << got->pixels << ")"
+                      << std::endl;
+            return 1;
+        }
+
+        if (want->audio != got->audio) {
+            std::cout << "frame " << want->frame << ": audio differs ("
+                      << (want->audio.empty() ? "none" : want->audio)
+                      << " != " << (got->audio.empty() ? "none" : got->audio)
+                      << ")" << std::endl;
+            return 1;
+        }
+
+        matched++;
+    }
+}
+
+// NOLINTEND
@@ -1,12 +1,19 @@
 #include "../../src/gdb_rsp.hh"
+#include "boot.hh"
 #include "bus.hh"
 #include "cpu/cpu.hh"
+#include "io/display/capture.hh"
+#include "savestate.hh"
 #include "util/loglevel.hh"
+#include <algorithm>
 #include <array>
 #include <cstdlib>
+#include <filesystem>
+#include <format>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <sys/resource.h>
 #include <vector>
 
 // NOLINTBEGIN
@@ -15,10 +22,25 @@ int
 main(int argc, const char* argv[]) {
     std::vector<uint8_t> rom;
     std::array<uint8_t, matar::Bus::BIOS_SIZE> bios = { 0 };
-    uint64_t cycles;
+    uint64_t cycles = 0;
+    uint64_t frames = 0;
+    double seconds  = 0;
 
     auto usage = [argv]() {
-        std::cerr << "Usage: " << argv[0] << " <file> [-b <bios>]" << std::endl;
+        std::cerr << "Usage: " << argv[0]
+                  << " <file> [-b <bios>]"
+                  << " [-c <cycles> | -f <frames> | --seconds <s>]"
+                  << " [-o <raw frames> | --capture <file.y4m | png prefix> |"
+                  << " --hash-log <file> [--hash-audio]]"
+                  << " [--frame-skip <n>]"
+                  << " [--frame-budget <ms> [--frame-skip <n > 1>]]"
+                  << " [--load-state <file>] [--save-state <file>]"
+                  << " [--boot <bios | direct | snapshot>]"
+                  << " [--boot-cache <dir>]"
+                  << " [--bench [--no-render] [--no-audio] [--no-output]]"
+                  << "\n  --frame-budget skips frames while the run is behind,"
+                  << " at most n - 1 in a row, 3 unless --frame-skip is given"
+                  << std::endl;
         std::exit(EXIT_FAILURE);
     };
 
@@ -26,6 +48,25 @@ main(int argc, const char* argv[]) {
         usage();
 
     std::string rom_file, bios_file = "gba_bios.bin";
+    std::string frames_file;
+    std::string capture_file;
+    std::string hash_file;
+    bool hash_audio = false;
+    matar::display::FrameSkip frame_skip;
+    bool frame_skip_given = false;
+    matar::BootMode boot = matar::BootMode::Bios;
+    std::filesystem::path boot_cache;
+    std::string load_file;
+    std::string save_file;
+    bool huge_pages = false;
+    bool bench      = false;
+    bool render     = true;
+    bool audio      = true;
+    bool output     = true;
+#ifdef ACCESS_STATS
+    std::string stats_file;
+    bool heatmap = false;
+#endif
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -40,13 +81,109 @@ main(int argc, const char* argv[]) {
                 cycles = std::stoull(argv[i]);
             else
                 usage();
+        } else if (arg == "-f") {
+            if (++i < argc)
+                frames = std::stoull(argv[i]);
+            else
+                usage();
+        } else if (arg == "--seconds") {
+            if (++i < argc)
+                seconds = std::stod(argv[i]);
+            else
+                usage();
+        } else if (arg == "-o") {
+            if (++i < argc)
+                frames_file = argv[i];
+            else
+                usage();
+        } else if (arg == "--capture") {
+            if (++i < argc)
+                capture_file = argv[i];
+            else
+                usage();
+        } else if (arg == "--hash-log") {
+            if (++i < argc)
+                hash_file = argv[i];
+            else
+                usage();
+        } else if (arg == "--hash-audio") {
+            hash_audio = true;
+        } else if (arg == "--frame-skip") {
+            if (++i < argc) {
+                frame_skip.every = std::stoul(argv[i]);
+                frame_skip_given = true;
+            } else {
+                usage();
+            }
+        } else if (arg == "--frame-budget") {
+            if (++i < argc)
+                frame_skip.budget =
+                  std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::duration<double, std::milli>(
+                      std::stod(argv[i])));
+            else
+                usage();
+        } else if (arg == "--boot") {
+            if (++i < argc)
+                boot = matar::parse_boot_mode(argv[i]);
+            else
+                usage();
+        } else if (arg == "--boot-cache") {
+            if (++i < argc)
+                boot_cache = argv[i];
+            else
+                usage();
+        } else if (arg == "--load-state") {
+            if (++i < argc)
+                load_file = argv[i];
+            else
+                usage();
+        } else if (arg == "--save-state") {
+            if (++i < argc)
+                save_file = argv[i];
+            else
+                usage();
+        } else if (arg == "--huge-pages") {
+            huge_pages = true;
+        } else if (arg == "--bench") {
+            bench = true;
+        } else if (arg == "--no-render") {
+            render = false;
+        } else if (arg == "--no-audio") {
+            audio = false;
+        } else if (arg == "--no-output") {
+            output = false;
+#ifdef ACCESS_STATS
+        } else if (arg == "--stats") {
+            if (++i < argc)
+                stats_file = argv[i];
+            else
+                usage();
+        } else if (arg == "--heatmap") {
+            heatmap = true;
+#endif
         } else {
             rom_file = arg;
         }
     }
-    std::cout << cycles << std::endl;
+    if (rom_file.empty() || (cycles == 0 && frames == 0 && seconds <= 0))
+        usage();
+
+    // a budget skips up to every - 1 frames in a row, none with the
+    // default of drawing every frame
+    if (frame_skip.budget.count() > 0) {
+        if (!frame_skip_given)
+            frame_skip.every = 4;
+        else if (frame_skip.every < 2)
+            usage();
+    }
+
+    // logs would slow the run down and get in the way of the results
+    if (bench)
+        matar::set_log_level(matar::LogLevel::Off);
 
-    if (rom_file.empty())
+    // the display hands frames to one sink only
+    if (!frames_file.empty() + !capture_file.empty() + !hash_file.empty() > 1)
         usage();
 
     try {
@@ -92,10 +229,196 @@ main(int argc, const char* argv[]) {
 
 
     try {
-        matar::Bus bus = matar::Bus(std::move(bios), std::move(rom));
+        // outlives the bus, whose sink thread may still be writing to it
+        std::unique_ptr<matar::display::RawFileSink> frames_sink;
+
+        if (!frames_file.empty())
+            frames_sink =
+              std::make_unique<matar::display::RawFileSink>(frames_file);
+
+        std::unique_ptr<matar::display::FrameSink> capture_encoder;
+        std::unique_ptr<matar::display::QueuedSink> capture;
+
+        if (!capture_file.empty()) {
+            if (capture_file.ends_with(".y4m"))
+                capture_encoder =
+                  std::make_unique<matar::display::Y4mSink>(capture_file);
+            else
+                capture_encoder =
+                  std::make_unique<matar::display::PngSink>(capture_file);
+
+            capture =
+              std::make_unique<matar::display::QueuedSink>(*capture_encoder);
+        }
+
+        matar::Bus bus(std::move(bios),
+                       std::move(rom),
+                       huge_pages ? std::make_unique<matar::MemoryArena>()
+                                  : nullptr);
         matar::Cpu cpu(bus);
 
-        bus.run(cycles);
+        // before any frames are handed out, the BIOS intro is not part of the
+        // run
+        matar::boot(bus,
+                    cpu,
+                    boot,
+                    boot_cache.empty() ? matar::default_boot_cache()
+                                       : boot_cache);
+
+        // not threaded, it is done with before the bus is gone
+        std::unique_ptr<matar::display::HashLogSink> hash_log;
+
+        if (!hash_file.empty()) {
+            std::function<uint64_t()> audio_hash;
+
+            if (hash_audio) {
+                bus.set_sample_hashing(true);
+                audio_hash = [&bus]() { return bus.take_sample_hash(); };
+            }
+
+            hash_log = std::make_unique<matar::display::HashLogSink>(
+              hash_file, std::move(audio_hash));
+        }
+
+        // benchmarks hand out frames all the same, to count what it costs
+        matar::display::NullSink null_sink;
+
+        if (output) {
+            if (capture)
+                bus.set_frame_sink(capture.get());
+            else if (frames_sink)
+                bus.set_frame_sink(frames_sink.get(), true);
+            else if (hash_log)
+                bus.set_frame_sink(hash_log.get());
+            else if (bench)
+                bus.set_frame_sink(&null_sink);
+        }
+
+        if (!render)
+            frame_skip.every = 0;
+
+        bus.set_frame_skip(frame_skip);
+        bus.set_sound_output(audio);
+
+#ifdef ACCESS_STATS
+        bus.access_stats().enable_heatmap(heatmap);
+#endif
+
+        // the run goes on from the state, for as long as it was asked to,
+        // cycles and frames alike count from there
+        if (!load_file.empty())
+            matar::load_state_file(bus, cpu, load_file);
+
+        if (frames > 0 || seconds > 0 || bench) {
+            // the GBA runs at 2^24 cycles per second
+            const auto emulated_cycles =
+              static_cast<uint64_t>(seconds * (1 << 24));
+
+            matar::RunStats total;
+            uint64_t ran = 0;
+
+            if (frames == 0 && seconds <= 0) {
+                // frames the cycles went through, counted all the same
+                const uint64_t first = bus.frame_count();
+
+                total = bus.run(cycles);
+                ran   = bus.frame_count() - first;
+            } else {
+                while (frames > 0 ? ran < frames
+                                  : total.cycles < emulated_cycles) {
+                    auto stats = bus.run_frame();
+
+                    total.cycles += stats.cycles;
+                    total.instructions += stats.instructions;
+                    total.events += stats.events;
+                    total.host_time += stats.host_time;
+                    ran++;
+                }
+            }
+
+            auto host_seconds =
+              std::chrono::duration<double>(total.host_time).count();
+            auto lines  = bus.line_stats();
+            auto reused = 100.0 * lines.reused /
+                          std::max<uint64_t>(lines.drawn + lines.reused, 1);
+
+            if (bench) {
+                rusage resources = {};
+                getrusage(RUSAGE_SELF, &resources);
+
+                auto quote = [](const std::string& string) {
+                    std::string quoted = "\"";
+
+                    for (char c : string) {
+                        if (c == '"' || c == '\\') {
+                            quoted += '\\';
+                            quoted += c;
+                        } else if (static_cast<unsigned char>(c) < 0x20) {
+                            quoted += std::format("\\u{:04x}",
+                                                  static_cast<int>(c));
+                        } else {
+                            quoted += c;
+                        }
+                    }
+
+                    return quoted + "\"";
+                };
+
+                auto boolean = [](bool b) { return b ? "true" : "false"; };
+
+                // a run of a few cycles may not get through a frame
+                const auto per_frame =
+                  static_cast<double>(std::max<uint64_t>(ran, 1));
+
+                std::cout
+                  << "{\"rom\": " << quote(rom_file)
+                  << ", \"render\": " << boolean(render)
+                  << ", \"audio\": " << boolean(audio)
+                  << ", \"output\": " << boolean(output)
+                  << ", \"frames\": " << ran
+                  << ", \"cycles\": " << total.cycles
+                  << ", \"instructions\": " << total.instructions
+                  << ", \"events\": " << total.events
+                  << ", \"host_seconds\": " << host_seconds
+                  << ", \"fps\": "
+                  << (host_seconds > 0 ? ran / host_seconds : 0)
+                  << ", \"mips\": "
+                  << (host_seconds > 0
+                        ? total.instructions / host_seconds / 1e6
+                        : 0)
+                  << ", \"ns_per_frame\": "
+                  << total.host_time.count() / per_frame
+                  << ", \"events_per_frame\": " << total.events / per_frame
+                  << ", \"lines_reused\": " << lines.reused
+                  << ", \"peak_rss_kb\": " << resources.ru_maxrss << "}"
+                  << std::endl;
+            } else {
+                std::cout << "frames: " << ran << "\n"
+                          << "cycles: " << total.cycles << "\n"
+                          << "instructions: " << total.instructions << "\n"
+                          << "events: " << total.events << "\n"
+                          << "host time: " << host_seconds << "s ("
+                          << ran / host_seconds << " fps)\n"
+                          << "lines reused: " << lines.reused << " ("
+                          << reused << "%)" << std::endl;
+            }
+        } else {
+            bus.run(cycles);
+        }
+
+        if (!save_file.empty())
+            matar::save_state_file(bus, cpu, save_file);
+
+        // stdout only has the JSON report on it with --bench
+        if (capture)
+            (bench ? std::cerr : std::cout)
+              << "capture dropped: " << capture->dropped() << " frames"
+              << std::endl;
+
+#ifdef ACCESS_STATS
+        if (!stats_file.empty())
+            bus.access_stats().dump(stats_file);
+#endif
 
     } catch (const std::exception& e) {
         std::cerr << "Exception: " << e.what() << std::endl;
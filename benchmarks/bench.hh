@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+namespace bench {
+// Runs body over the given number of iterations a few times and prints how
+// long the fastest run took for each, if the name has the filter passed on
+// the command line in it. unit names what one iteration is.
+void
+measure(std::string_view name,
+        std::string_view unit,
+        uint64_t iterations,
+        const std::function<void(uint64_t)>& body);
+
+// keeps the compiler from optimising away whatever went into value
+template<typename T>
+inline void
+keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// deterministic pseudo random numbers, for filling fixtures
+class Random {
+  public:
+    explicit Random(uint64_t seed)
+      : state(seed) {}
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<uint32_t>(state >> 32);
+    }
+
+  private:
+    uint64_t state;
+};
+
+void
+cpu();
+void
+bus();
+void
+display();
+void
+scheduler();
+}
@@ -0,0 +1,103 @@
+#include "bench.hh"
+#include "bus.hh"
+#include "cpu/cpu.hh"
+#include <format>
+
+using namespace matar;
+
+static constexpr uint64_t ACCESSES = 5'000'000;
+
+namespace {
+struct Region {
+    const char* name;
+    // addresses read from
+    uint32_t read_start;
+    // addresses written to, none for read only memory
+    uint32_t write_start;
+    // accesses go round within this many bytes from the start, a power of 2
+    uint32_t size;
+};
+}
+
+// reads or writes every width in turn, walking through a region
+template<typename T>
+static void
+access(Bus& bus, const Region& region, bool write) {
+    static constexpr const char* WIDTH = sizeof(T) == 1   ? "byte"
+                                         : sizeof(T) == 2 ? "halfword"
+                                                          : "word";
+    const uint32_t start = write ? region.write_start : region.read_start;
+
+    auto body = [&bus, start, size = region.size, write](uint64_t n) {
+        uint32_t checksum = 0;
+
+        for (uint64_t i = 0; i < n; i++) {
+            const uint32_t address = start + (i * sizeof(T) & (size - 1));
+
+            if constexpr (sizeof(T) == 1) {
+                if (write) {
+                    bus.write_byte(address, i);
+                } else {
+                    checksum += bus.read_byte(address);
+                }
+            } else if constexpr (sizeof(T) == 2) {
+                if (write) {
+                    bus.write_halfword(address, i);
+                } else {
+                    checksum += bus.read_halfword(address);
+                }
+            } else {
+                if (write) {
+                    bus.write_word(address, i);
+                } else {
+                    checksum += bus.read_word(address);
+                }
+            }
+        }
+
+        bench::keep(checksum);
+    };
+
+    bench::measure(std::format("bus {} {} {}",
+                               write ? "write" : "read",
+                               WIDTH,
+                               region.name),
+                   "access",
+                   ACCESSES,
+                   body);
+}
+
+namespace bench {
+void
+bus() {
+    /* IO is read from the display registers that can be read and written to
+     * the background offsets, which do nothing until a line is drawn */
+    static constexpr Region REGIONS[] = {
+        { "bios", 0x00000000, 0, 0x4000 },
+        { "ewram", 0x02000000, 0x02000000, 0x40000 },
+        { "iwram", 0x03000000, 0x03000000, 0x8000 },
+        { "io", 0x04000000, 0x04000010, 0x10 },
+        { "pram", 0x05000000, 0x05000000, 0x400 },
+        { "vram", 0x06000000, 0x06000000, 0x10000 },
+        { "oam", 0x07000000, 0x07000000, 0x400 },
+        { "rom", 0x08000000, 0, 0x100000 },
+    };
+
+    Bus bus(std::array<uint8_t, Bus::BIOS_SIZE>(),
+            std::vector<uint8_t>(0x100000));
+    /* BIOS reads go through as long as the CPU is in there */
+    Cpu cpu(bus);
+
+    for (const Region& region : REGIONS) {
+        access<uint8_t>(bus, region, false);
+        access<uint16_t>(bus, region, false);
+        access<uint32_t>(bus, region, false);
+
+        if (region.write_start != 0) {
+            access<uint8_t>(bus, region, true);
+            access<uint16_t>(bus, region, true);
+            access<uint32_t>(bus, region, true);
+        }
+    }
+}
+}
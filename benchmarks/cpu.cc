@@ -0,0 +1,94 @@
+#include "bench.hh"
+#include "bus.hh"
+#include "cpu/cpu.hh"
+#include <cstring>
+#include <vector>
+
+using namespace matar;
+
+static constexpr uint64_t INSTRUCTIONS = 2'000'000;
+
+// Runs a program placed at the start of the ROM, reached through a BIOS that
+// does nothing but jump there. The programs loop forever, each step is one
+// instruction.
+static void
+run_program(std::string_view name, const std::vector<uint32_t>& program) {
+    std::array<uint8_t, Bus::BIOS_SIZE> bios = {};
+    /* ldr pc, [pc], the address to load is right after the prefetched
+     * instruction */
+    const uint32_t trampoline[] = { 0xE59FF000, 0, 0x08000000 };
+    std::memcpy(bios.data(), trampoline, sizeof(trampoline));
+
+    std::vector<uint8_t> rom(Header::HEADER_SIZE);
+    std::memcpy(rom.data(), program.data(), program.size() * 4);
+
+    Bus bus(std::move(bios), std::move(rom));
+    Cpu cpu(bus);
+
+    /* get out of the BIOS first */
+    for (int i = 0; i < 4; i++) {
+        cpu.step();
+    }
+
+    bench::measure(name, "instruction", INSTRUCTIONS, [&cpu](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            cpu.step();
+        }
+    });
+}
+
+namespace bench {
+void
+cpu() {
+    run_program("cpu arm alu",
+                {
+                  0xE0811002, // add r1, r1, r2
+                  0xE0233001, // eor r3, r3, r1
+                  0xE2544001, // subs r4, r4, #1
+                  0xE1A05181, // mov r5, r1, lsl #3
+                  0xEAFFFFFA, // b 0x08000000
+                });
+
+    run_program("cpu arm ldm/stm",
+                {
+                  0xE3A00403, // mov r0, #0x03000000
+                  0xE88001FE, // stmia r0, {r1-r8}
+                  0xE89001FE, // ldmia r0, {r1-r8}
+                  0xEAFFFFFC, // b 0x08000004
+                });
+
+    run_program("cpu arm branch",
+                {
+                  0xEA000000, // b 0x08000008
+                  0xEAFFFFFD, // b 0x08000000
+                  0xEAFFFFFD, // b 0x08000004
+                });
+
+    /* halfwords are listed lowest first in each word */
+    run_program("cpu thumb alu",
+                {
+                  0xE28F0001, // add r0, pc, #1
+                  0xE12FFF10, // bx r0
+                  0x404B1889, // add r1, r1, r2; eor r3, r1
+                  0x3C0100CD, // lsl r5, r1, #3; sub r4, #1
+                  0x0000E7FA, // b 0x08000008
+                });
+
+    run_program("cpu thumb ldm/stm",
+                {
+                  0xE28F0001, // add r0, pc, #1
+                  0xE12FFF10, // bx r0
+                  0x06002003, // mov r0, #3; lsl r0, r0, #24
+                  0x381CC0FE, // stmia r0!, {r1-r7}; sub r0, #28
+                  0x381CC8FE, // ldmia r0!, {r1-r7}; sub r0, #28
+                  0x0000E7FA, // b 0x0800000C
+                });
+
+    run_program("cpu thumb branch",
+                {
+                  0xE28F0001, // add r0, pc, #1
+                  0xE12FFF10, // bx r0
+                  0x0000E7FE, // b 0x08000008
+                });
+}
+}
@@ -0,0 +1,137 @@
+#include "bench.hh"
+#include "bus.hh"
+#include "io/display/display.hh"
+#include <format>
+
+using namespace matar;
+using namespace matar::display;
+
+static constexpr uint64_t FRAMES = 100;
+
+namespace {
+// registers making up a scene in one of the background modes
+struct Scene {
+    uint16_t mode;
+    // backgrounds the mode draws
+    uint16_t backgrounds;
+};
+}
+
+// Fills VRAM, PRAM and OAM with the same pseudo random data every time, so
+// that tiles, maps, bitmaps, colors and objects are all over the place, and
+// turns on every background the mode has, all objects and alpha blending.
+static void
+load_scene(Display& display, const Scene& scene) {
+    bench::Random random(scene.mode + 1);
+
+    auto fill = [&random](auto& memory) {
+        for (size_t i = 0; i < memory.size(); i += 4) {
+            memory.write_word(i, random.next());
+        }
+    };
+
+    fill(display.get_vram());
+    fill(display.get_pram());
+    fill(display.get_oam());
+
+    for (uint32_t address = 0; address < display.get_pram().size();
+         address += 4) {
+        display.pram_written(address);
+    }
+    display.oam_written();
+
+    /* 1D object mapping, objects and the backgrounds on */
+    display.write_halfword(0x4000000,
+                           scene.mode | 1 << 6 | scene.backgrounds << 8 |
+                             1 << 12);
+
+    /* mixed priorities, character blocks, color depths and sizes, a screen
+     * block each at the end of background VRAM */
+    for (uint16_t bg = 0; bg < 4; bg++) {
+        const uint16_t control = (bg ^ 1) | (bg & 1) << 2 | (bg == 1) << 7 |
+                                 (bg == 2) << 13 | (28 + bg) << 8 | bg << 14;
+
+        display.write_halfword(0x4000008 + bg * 2, control);
+        display.write_halfword(0x4000010 + bg * 4, random.next() & 0x1FF);
+        display.write_halfword(0x4000012 + bg * 4, random.next() & 0x1FF);
+    }
+
+    /* rotated a bit and scaled up, for both affine backgrounds */
+    for (uint32_t base : { 0x4000020, 0x4000030 }) {
+        display.write_halfword(base, 0x00F0);
+        display.write_halfword(base + 2, 0x0040);
+        display.write_halfword(base + 4, 0xFFC0);
+        display.write_halfword(base + 6, 0x00F0);
+        display.write_halfword(base + 8, 0x1000);
+        display.write_halfword(base + 12, 0x0800);
+    }
+
+    /* BG0 blended with everything behind it */
+    display.write_halfword(0x4000050, 0x3F41);
+    display.write_halfword(0x4000052, 0x0A06);
+}
+
+// runs frames the way the bus would, through the display's own events
+static void
+run_frames(Scheduler& scheduler, Display& display, uint64_t frames) {
+    const uint64_t end = display.frame_count() + frames;
+
+    while (display.frame_count() < end) {
+        /* something has to change for lines not to be left as they were */
+        display.get_vram().write_halfword(0, display.frame_count());
+        display.vram_written(0);
+
+        const uint64_t frame = display.frame_count();
+
+        while (display.frame_count() == frame) {
+            Task task = scheduler.top();
+            scheduler.pop();
+
+            scheduler.add_cycles(task.cycles - scheduler.get_cycles());
+
+            if (task.type == Task::Type::DISPLAY_HBLANK) {
+                display.hblank_begin(task.cycles);
+            } else if (task.type == Task::Type::DISPLAY_HDRAW) {
+                display.hblank_end(task.cycles);
+            }
+        }
+    }
+}
+
+namespace bench {
+void
+display() {
+    static constexpr Scene SCENES[] = {
+        { 0, 0b1111 }, { 1, 0b0111 }, { 2, 0b1100 },
+        { 3, 0b0100 }, { 4, 0b0100 }, { 5, 0b0100 },
+    };
+
+    /* the display only needs these for interrupts and DMA, which stay off */
+    Bus bus(std::array<uint8_t, Bus::BIOS_SIZE>(),
+            std::vector<uint8_t>(Header::HEADER_SIZE));
+    Scheduler scheduler;
+    System system(bus);
+    Dma dma(bus, scheduler, system);
+
+    for (const Scene& scene : SCENES) {
+        Display display(scheduler, system, dma);
+
+        load_scene(display, scene);
+        /* warm up the tile cache */
+        run_frames(scheduler, display, 1);
+
+        /* whole frames, counted per line drawn */
+        measure(std::format("display mode {}", scene.mode),
+                "line",
+                FRAMES * LCD_HEIGHT,
+                [&](uint64_t lines) {
+                    run_frames(scheduler, display, lines / LCD_HEIGHT);
+                });
+
+        /* the next display starts with the scheduler to itself */
+        while (!scheduler.empty()) {
+            scheduler.pop();
+        }
+    }
+}
+}
@@ -0,0 +1,65 @@
+#include "bench.hh"
+#include "util/loglevel.hh"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace bench {
+static std::string_view filter;
+
+void
+measure(std::string_view name,
+        std::string_view unit,
+        uint64_t iterations,
+        const std::function<void(uint64_t)>& body) {
+    static constexpr int RUNS = 3;
+
+    if (!name.contains(filter)) {
+        return;
+    }
+
+    double best = 0;
+
+    for (int run = 0; run < RUNS; run++) {
+        auto start = std::chrono::steady_clock::now();
+
+        body(iterations);
+
+        std::chrono::duration<double, std::nano> elapsed =
+          std::chrono::steady_clock::now() - start;
+
+        const double each = elapsed.count() / static_cast<double>(iterations);
+        best              = run == 0 ? each : std::min(best, each);
+    }
+
+    std::printf("%-44.*s %10.2f ns/%.*s\n",
+                static_cast<int>(name.size()),
+                name.data(),
+                best,
+                static_cast<int>(unit.size()),
+                unit.data());
+}
+}
+
+int
+main(int argc, const char* argv[]) {
+    if (argc > 2) {
+        std::fprintf(stderr, "Usage: %s [name filter]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc == 2) {
+        bench::filter = argv[1];
+    }
+
+    /* the CPU would otherwise log every instruction it runs */
+    matar::set_log_level(matar::LogLevel::Off);
+
+    bench::cpu();
+    bench::bus();
+    bench::display();
+    bench::scheduler();
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "scheduler.hh"
+#include "bench.hh"
+#include <format>
+
+using namespace matar;
+
+// Replays a frame-like event mix: the display alternating between HDraw and
+// HBlank, PWM sampling, one timer feeding the sound FIFOs, a free running
+// timer far ahead of everything else and a DMA every few lines.
+template<typename Queue>
+static void
+frame_mix(uint64_t events) {
+    BasicScheduler<Queue> scheduler;
+    uint64_t checksum = 0;
+
+    scheduler.schedule_at(Task::Type::DISPLAY_HBLANK, 960);
+    scheduler.schedule_at(Task::Type::SAMPLE_PWM, 512);
+    scheduler.schedule_at(Task::Type::TIMER0_OVERFLOW, 1024);
+    scheduler.schedule_at(Task::Type::TIMER3_OVERFLOW, 0x40000);
+
+    for (uint64_t i = 0; i < events; i++) {
+        Task task = scheduler.top();
+        scheduler.pop();
+
+        scheduler.add_cycles(task.cycles - scheduler.get_cycles());
+        checksum += task.cycles;
+
+        switch (task.type) {
+            case Task::Type::DISPLAY_HBLANK:
+                scheduler.schedule_from_now(Task::Type::DISPLAY_HDRAW, 272);
+                if (i % 8 == 0) {
+                    scheduler.schedule_from_now(Task::Type::DMA0_ACTIVATE, 3);
+                }
+                break;
+            case Task::Type::DISPLAY_HDRAW:
+                scheduler.schedule_from_now(Task::Type::DISPLAY_HBLANK, 960);
+                break;
+            case Task::Type::SAMPLE_PWM:
+                scheduler.schedule_from_now(Task::Type::SAMPLE_PWM, 512);
+                break;
+            case Task::Type::TIMER0_OVERFLOW:
+                scheduler.schedule_from_now(Task::Type::TIMER0_OVERFLOW, 1024);
+                break;
+            case Task::Type::TIMER3_OVERFLOW:
+                scheduler.schedule_from_now(Task::Type::TIMER3_OVERFLOW,
+                                            0x40000);
+                break;
+            default:
+                break;
+        }
+    }
+
+    bench::keep(checksum);
+}
+
+// Keeps depth events pending at once, taking the earliest off and putting
+// another one in at a pseudo random time after it, so that every iteration is
+// one push and one pop.
+template<typename Queue>
+static void
+push_pop(uint64_t events, uint32_t depth) {
+    BasicScheduler<Queue> scheduler;
+    bench::Random random(depth);
+    uint64_t checksum = 0;
+
+    for (uint32_t i = 0; i < depth; i++) {
+        scheduler.schedule_at(Task::Type::SAMPLE_PWM, random.next() % 4096);
+    }
+
+    for (uint64_t i = 0; i < events; i++) {
+        Task task = scheduler.top();
+        scheduler.pop();
+
+        scheduler.add_cycles(task.cycles - scheduler.get_cycles());
+        checksum += task.cycles;
+
+        scheduler.schedule_from_now(Task::Type::SAMPLE_PWM,
+                                    1 + random.next() % 4096);
+    }
+
+    bench::keep(checksum);
+}
+
+template<typename Queue>
+static void
+measure_queue(std::string_view queue) {
+    static constexpr uint64_t EVENTS = 5'000'000;
+
+    bench::measure(std::format("scheduler frame mix, {}", queue),
+                   "event",
+                   EVENTS,
+                   [](uint64_t events) { frame_mix<Queue>(events); });
+
+    for (uint32_t depth : { 8, 64, 512 }) {
+        bench::measure(
+          std::format("scheduler push/pop {} deep, {}", depth, queue),
+          "event",
+          EVENTS,
+          [depth](uint64_t events) { push_pop<Queue>(events, depth); });
+    }
+}
+
+namespace bench {
+void
+scheduler() {
+    measure_queue<HeapQueue>("priority queue");
+    measure_queue<TimingWheel>("timing wheel");
+}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace matar {
+class AccessStats {
+  public:
+    enum class Region {
+        Bios,
+        Ewram,
+        Iwram,
+        Io,
+        Pram,
+        Vram,
+        Oam,
+        Rom,
+        Sram,
+        Unmapped
+    };
+
+    enum class Direction {
+        Read,
+        Write
+    };
+
+    static constexpr int N_REGIONS    = 10;
+    static constexpr int N_DIRECTIONS = 2;
+    static constexpr int N_WIDTHS     = 3; // 8, 16 and 32 bit
+    static constexpr int N_ACCESSES   = 2; // non sequential and sequential
+
+    // heatmaps count accesses at this granularity
+    static constexpr uint32_t PAGE_SIZE = 4 * 1024;
+
+    struct Counter {
+        uint64_t count;
+        uint64_t cycles;
+    };
+
+    static Region region(uint32_t address);
+    static const char* region_name(Region region);
+
+    void record(uint32_t address,
+                Direction direction,
+                uint8_t size,
+                bool sequential,
+                uint8_t cycles) {
+        Region r = region(address);
+        auto& counter =
+          counters[static_cast<int>(r)][static_cast<int>(direction)]
+                  [size >> 1][sequential];
+
+        counter.count++;
+        counter.cycles += cycles;
+
+        if (heatmap_enabled) {
+            record_page(r, direction, address);
+        }
+    }
+
+    Counter get(Region region,
+                Direction direction,
+                uint8_t size,
+                bool sequential) const {
+        return counters[static_cast<int>(region)][static_cast<int>(direction)]
+                       [size >> 1][sequential];
+    }
+
+    void enable_heatmap(bool enable);
+    bool heatmap() const { return heatmap_enabled; }
+
+    void reset();
+
+    // one row per region/direction/width/access combination that was hit
+    std::string to_csv() const;
+    // one row per 4 KiB page that was hit, empty if heatmap is disabled
+    std::string heatmap_to_csv() const;
+    std::string to_json() const;
+
+    // format is chosen by the extension, ".json" or anything else for CSV.
+    // CSV heatmaps go to a sibling file with a "-heatmap.csv" suffix
+    void dump(const std::string& path) const;
+
+  private:
+    std::array<
+      std::array<std::array<std::array<Counter, N_ACCESSES>, N_WIDTHS>,
+                 N_DIRECTIONS>,
+      N_REGIONS>
+      counters = {};
+
+    bool heatmap_enabled = false;
+    std::array<std::array<std::vector<uint64_t>, N_DIRECTIONS>, N_REGIONS>
+      pages;
+
+    void record_page(Region region, Direction direction, uint32_t address);
+};
+}
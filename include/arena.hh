@@ -0,0 +1,93 @@
+#pragma once
+
+#include "memory.hh"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+
+namespace matar {
+// One contiguous block holding all the guest memory of an instance, backed by
+// huge pages if the host allows it so that the whole working set is covered
+// by a single TLB entry.
+//
+// Forkable arenas are instead a memory file mapped copy-on-write, and forks of
+// them map the same file, so that they share every page until one of them
+// writes to it. Those are made of regular pages, a huge page would be copied
+// whole on the first write.
+class MemoryArena {
+  public:
+    static constexpr std::size_t SIZE      = 2 * 1024 * 1024;
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    enum class Backing {
+        HugeTlb,     // explicit huge page from the hugetlbfs pool
+        Transparent, // transparent huge pages via madvise
+        Regular,     // plain pages, huge pages are not available
+        Forkable     // plain pages of a memory file, see fork
+    };
+
+    MemoryArena();
+    ~MemoryArena();
+
+    MemoryArena(const MemoryArena&)            = delete;
+    MemoryArena& operator=(const MemoryArena&) = delete;
+
+    // throws std::system_error if the host has no memory files
+    static std::unique_ptr<MemoryArena> forkable(std::size_t size = SIZE);
+
+    // Makes an arena holding what this one does, with nothing handed out of
+    // it yet: allocating the same blocks in the same order gets back the same
+    // contents. Only forkable arenas can be forked.
+    std::unique_ptr<MemoryArena> fork();
+
+    template<std::size_t N>
+    std::span<uint8_t, N> allocate() {
+        return std::span<uint8_t, N>(allocate(N).data(), N);
+    }
+
+    std::span<uint8_t> allocate(std::size_t n) {
+        std::size_t offset = (used + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+        if (offset + n > size) {
+            throw std::bad_alloc();
+        }
+
+        used = offset + n;
+        return { base + offset, n };
+    }
+
+    Backing backing() const { return backing_; }
+
+    // everything handed out so far, in allocation order
+    std::span<uint8_t> data() const { return { base, used }; }
+
+  private:
+    uint8_t* base;
+    std::size_t size = SIZE;
+    std::size_t used = 0;
+    Backing backing_;
+
+    /* the memory file of a forkable arena, which holds what the arena does
+     * but for the pages written since it was last mapped, and whether
+     * writes go to the file rather than to pages of the arena's own */
+    int file    = -1;
+    bool shared = false;
+
+    MemoryArena(std::size_t size, int file, bool shared);
+
+    bool has_own_pages() const;
+};
+
+// view into the arena if there is one, otherwise a standalone block
+template<std::size_t N>
+Memory<N>
+arena_memory(MemoryArena* arena) {
+    if (arena == nullptr) {
+        return Memory<N>();
+    }
+
+    return Memory<N>(arena->allocate<N>());
+}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+
+namespace matar {
+class Bus;
+class Cpu;
+
+enum class BootMode {
+    // runs the BIOS, intro and all
+    Bios,
+    // starts at the cartridge with everything set up as the BIOS leaves it
+    Direct,
+    // Loads the state the BIOS leaves the ROM in from a cache, running the
+    // BIOS and saving the state there first if it is not in it yet. Unlike
+    // a direct boot, the run goes on exactly as if the BIOS had been run.
+    Snapshot,
+};
+
+// takes bios, direct or snapshot, throws std::invalid_argument otherwise
+BootMode
+parse_boot_mode(std::string_view name);
+
+// the cache used for snapshots if no other is given, matar in the user's
+// cache directory: $XDG_CACHE_HOME, or ~/.cache without it
+std::filesystem::path
+default_boot_cache();
+
+// Gets a machine that has just been made to the start of the cartridge, the
+// BIOS mode leaves it as it is.
+void
+boot(Bus& bus,
+     Cpu& cpu,
+     BootMode mode,
+     const std::filesystem::path& cache = default_boot_cache());
+}
@@ -1,9 +1,14 @@
 #pragma once
 
+#include "access_stats.hh"
+#include "arena.hh"
 #include "header.hh"
 #include "io/io.hh"
 #include "memory.hh"
 #include "scheduler.hh"
+#include "util/state.hh"
+#include <chrono>
+#include <functional>
 #include <vector>
 
 namespace matar {
@@ -21,11 +26,28 @@ struct CycleCount {
     uint8_t s32; // sequential 32 bit width access
 };
 
+// what a call to one of the Bus::run functions did
+struct RunStats {
+    uint64_t cycles       = 0; // emulated cycles executed
+    uint64_t instructions = 0; // instructions retired
+    uint64_t events       = 0; // scheduler events dispatched
+    std::chrono::nanoseconds host_time{ 0 };
+};
+
 class Bus {
   public:
     static constexpr uint32_t BIOS_SIZE = 1024 * 16;
 
-    Bus(std::array<uint8_t, BIOS_SIZE>&&, std::vector<uint8_t>&&);
+    // guest memory is placed in the arena if one is given, a forkable one
+    // gets the ROM placed in a forkable arena of its own as well
+    Bus(std::array<uint8_t, BIOS_SIZE>&&,
+        std::vector<uint8_t>&&,
+        std::unique_ptr<MemoryArena> arena = nullptr);
+
+    // A bus with the guest memory and ROM of another, shared copy-on-write,
+    // and none of its other state, see fork. Throws std::logic_error unless
+    // the other bus was given a forkable arena.
+    static std::unique_ptr<Bus> sharing_memory_of(Bus& other);
 
     void attach_cpu(Cpu* c) { cpu = c; }
 
@@ -54,7 +76,70 @@ class Bus {
     // not sure what else to do?
     void internal_cycle() { scheduler.add_cycles(1); }
     uint64_t get_cycles() const { return scheduler.get_cycles(); }
-    void run(uint64_t);
+
+    // runs for at least this many cycles from where the machine is, a
+    // machine loaded from a state or booted goes on from its own clock
+    RunStats run(uint64_t cycles);
+
+    // Runs until the predicate holds, it is checked before starting and after
+    // every scheduler event. Throws std::runtime_error if the program does
+    // what the emulator cannot go on from, like a DMA with the prohibited
+    // source address control, and the machine is not to be run after that.
+    RunStats run_until(const std::function<bool()>& done);
+
+    // runs until the start of the next VBlank
+    RunStats run_frame();
+
+    // Runs the BIOS until it jumps to the cartridge, throws
+    // std::runtime_error if it has not within a few seconds.
+    RunStats run_bios();
+
+    // puts the devices where the BIOS leaves them, see Cpu::skip_bios
+    void skip_bios();
+
+    uint64_t frame_count() const { return io.frame_count(); }
+
+    // lines drawn, and lines left as they were in the last frame
+    const display::Display::LineStats& line_stats() const {
+        return io.line_stats();
+    }
+
+    void set_pixel_format(display::PixelFormat format) {
+        io.set_pixel_format(format);
+    }
+
+    // see display::Display::set_frame_sink
+    void set_frame_sink(display::FrameSink* sink, bool threaded = false) {
+        io.set_frame_sink(sink, threaded);
+    }
+
+    // see display::FrameSkip
+    void set_frame_skip(const display::FrameSkip& skip) {
+        io.set_frame_skip(skip);
+    }
+
+    // see sound::Sound::set_output
+    void set_sound_output(bool enable) { io.set_sound_output(enable); }
+
+    // guest memory, scheduler and devices, the CPU is saved on its own
+    void save(StateWriter& state) const;
+    void load(StateReader& state);
+
+    // hash of the ROM, to tell which game a savestate belongs to
+    uint64_t rom_hash() const { return rom_digest; }
+    uint64_t bios_hash() const { return bios_digest; }
+
+    // see System::set_keys
+    void set_keys(uint16_t pressed) { io.set_keys(pressed); }
+
+    // see sound::Sound::set_sample_hashing
+    void set_sample_hashing(bool enable) { io.set_sample_hashing(enable); }
+    uint64_t take_sample_hash() { return io.take_sample_hash(); }
+
+#ifdef ACCESS_STATS
+    AccessStats& access_stats() { return stats; }
+    const AccessStats& access_stats() const { return stats; }
+#endif
 
   private:
     Cpu* cpu;
@@ -68,8 +153,20 @@ class Bus {
     template<typename T>
     void write(uint32_t address, T value);
 
+    // adds the waitstates for an access of type T to the clock
+    template<typename T>
+    void access_cycles(uint32_t address,
+                       CpuAccess access,
+                       AccessStats::Direction direction);
+
     std::array<CycleCount, 0x10> cycle_map;
 
+#ifdef ACCESS_STATS
+    AccessStats stats;
+#endif
+
+    std::unique_ptr<MemoryArena> arena;
+    std::unique_ptr<MemoryArena> rom_arena;
     Scheduler scheduler;
     IoDevices io;
 
@@ -77,15 +174,21 @@ class Bus {
     static constexpr uint32_t CHIP_WRAM_SIZE  = 1024 * 32;
     static constexpr uint32_t SRAM_SIZE       = 1024 * 256;
 
-    Memory<BIOS_SIZE> bios             = {};
-    Memory<BOARD_WRAM_SIZE> board_wram = {};
-    Memory<CHIP_WRAM_SIZE> chip_wram   = {};
-    Memory<SRAM_SIZE> sram             = {};
+    Memory<BIOS_SIZE> bios;
+    Memory<BOARD_WRAM_SIZE> board_wram;
+    Memory<CHIP_WRAM_SIZE> chip_wram;
+    Memory<SRAM_SIZE> sram;
     Memory<> rom;
 
-    uint32_t last_bios_word;
+    uint32_t last_bios_word = 0;
+    uint64_t rom_digest;
+    uint64_t bios_digest;
 
     Header header;
     void parse_header();
+
+    Bus(const Bus& other,
+        std::unique_ptr<MemoryArena> arena,
+        std::unique_ptr<MemoryArena> rom_arena);
 };
 }
@@ -4,6 +4,7 @@
 #include "bus.hh"
 #include "cpu/psr.hh"
 #include "thumb/instruction.hh"
+#include "util/state.hh"
 #include <cstdint>
 
 #ifdef GDB_DEBUG
@@ -33,6 +34,13 @@ class Cpu {
 
     void irq();
 
+    // Sets the registers the way the BIOS leaves them and starts at the
+    // cartridge, see Bus::skip_bios.
+    void skip_bios();
+
+    void save(StateWriter& state) const;
+    void load(StateReader& state);
+
 #ifdef GDB_DEBUG
     bool breakpoint_reached() {
         if (breakpoints.contains(pc - 2 * (cpsr.state() == State::Arm
@@ -46,6 +54,7 @@ class Cpu {
   private:
     static constexpr auto SWI_VECTOR = 0x8;
     static constexpr auto IRQ_VECTOR = 0x18;
+    static constexpr auto ROM_START  = 0x8000000;
 
     friend void arm::Instruction::exec(Cpu& cpu);
     friend void thumb::Instruction::exec(Cpu& cpu);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "bus.hh"
+#include "cpu/cpu.hh"
+#include <memory>
+
+namespace matar {
+// a machine of its own, the CPU is destroyed before the bus it is attached to
+struct Instance {
+    std::unique_ptr<Bus> bus;
+    std::unique_ptr<Cpu> cpu;
+};
+
+// Clones a machine whose bus was given a forkable arena, see
+// MemoryArena::fork. The guest memory and ROM are shared copy-on-write, only
+// pages either of the two writes to later get copied, and all other state is
+// copied as a savestate would have it, host side settings are not. Forking
+// makes the pages written since the machine was last forked its own again, so
+// it cannot happen while the machine is running.
+Instance
+fork(Bus& bus, Cpu& cpu);
+}
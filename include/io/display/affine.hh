@@ -0,0 +1,58 @@
+#pragma once
+
+#include "registers.hh"
+#include <cstdint>
+#include <span>
+
+namespace matar {
+namespace display {
+// Samplers for backgrounds and objects drawn through an affine transform.
+// They produce a whole run of pixels in one go, eight at a time with AVX2
+// if the host has it and one at a time otherwise. Texels are found as
+// (origin + i * step) >> 8 for the i'th pixel of the run.
+
+struct AffineBackground {
+    const uint8_t* vram;
+    // the 256 background colors, with the unused bit cleared
+    const uint16_t* palette;
+
+    uint32_t tile_base;
+    uint32_t map_base;
+    // width and height in pixels, a power of 2 from 128 to 1024
+    int32_t size;
+    bool wraparound;
+
+    Vec2<int32_t> origin;
+    Vec2<int32_t> step;
+};
+
+// fills the line with the colors of the background, or TRANSPARENT_RGB555
+void
+sample_affine_background(const AffineBackground& bg,
+                         std::span<uint16_t, LCD_WIDTH> line);
+
+struct AffineObject {
+    const uint8_t* vram;
+    uint32_t vram_size;
+    // all of PRAM, colors with the unused bit cleared
+    const uint16_t* palette;
+    // index of color 0 of the object in palette
+    uint32_t palette_offset;
+
+    uint32_t tile_base;
+    // tiles between the starts of two rows of 8 pixels
+    uint32_t tiles_per_row;
+    bool colors256;
+    Vec2<int32_t> size;
+
+    // relative to the center of the object
+    Vec2<int32_t> origin;
+    Vec2<int32_t> step;
+};
+
+// colors of the first pixels.size() pixels of a run over the object, or
+// TRANSPARENT_RGB555
+void
+sample_affine_object(const AffineObject& obj, std::span<uint16_t> pixels);
+}
+}
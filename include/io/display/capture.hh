@@ -0,0 +1,105 @@
+#pragma once
+
+#include "frame_sink.hh"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <util/spsc.hh>
+#include <vector>
+
+namespace matar {
+namespace display {
+// writes frames as a YUV4MPEG2 stream with full resolution chroma, which
+// video encoders such as ffmpeg take as is
+class Y4mSink : public FrameSink {
+  public:
+    explicit Y4mSink(const std::string& path);
+    ~Y4mSink() override;
+
+    Y4mSink(const Y4mSink&)            = delete;
+    Y4mSink& operator=(const Y4mSink&) = delete;
+
+    void consume(const Frame& frame) override;
+
+  private:
+    std::FILE* file;
+    bool header_written = false;
+    std::vector<uint16_t> colors;
+    std::vector<uint8_t> planes;
+};
+
+// writes every frame to a PNG file of its own
+class PngSink : public FrameSink {
+  public:
+    // files are named prefix, then the frame number in 6 digits and .png
+    explicit PngSink(std::string prefix);
+
+    void consume(const Frame& frame) override;
+
+  private:
+    std::string prefix;
+    std::vector<uint16_t> colors;
+    std::vector<uint8_t> scanlines;
+};
+
+// Writes a line for every frame with its number and a hash of its pixels,
+// and of the audio made along with it if there is a way to get that. Runs
+// that behave the same log the same hashes, as long as they render in the
+// same pixel format and skip the same frames.
+class HashLogSink : public FrameSink {
+  public:
+    explicit HashLogSink(const std::string& path,
+                         std::function<uint64_t()> audio_hash = nullptr);
+    ~HashLogSink() override;
+
+    HashLogSink(const HashLogSink&)            = delete;
+    HashLogSink& operator=(const HashLogSink&) = delete;
+
+    void consume(const Frame& frame) override;
+
+  private:
+    std::FILE* file;
+    std::function<uint64_t()> audio_hash;
+};
+
+// Hands frames to another sink on a thread of its own, with up to depth
+// frames waiting in between for when the sink falls behind for a bit. The
+// frame is copied and queued without ever waiting on the sink, if the queue
+// is full it is dropped instead.
+class QueuedSink : public FrameSink {
+  public:
+    explicit QueuedSink(FrameSink& sink, uint32_t depth = 8);
+    // the sink still gets the frames that were queued
+    ~QueuedSink() override;
+
+    QueuedSink(const QueuedSink&)            = delete;
+    QueuedSink& operator=(const QueuedSink&) = delete;
+
+    void consume(const Frame& frame) override;
+
+    // frames that did not fit in the queue
+    uint64_t dropped() const { return drops.load(); }
+
+  private:
+    FrameSink& sink;
+
+    /* pixels of queued frames, by slot */
+    std::vector<std::vector<uint8_t>> pixels;
+    std::vector<Frame> frames;
+
+    /* slots waiting for the sink, and slots the sink is done with */
+    SPSCBuffer<uint32_t> queued;
+    SPSCBuffer<uint32_t> free;
+
+    std::atomic<uint64_t> drops   = 0;
+    std::atomic<uint64_t> wakeups = 0;
+    std::atomic<bool> stopping    = false;
+    std::thread thread;
+
+    void run();
+};
+}
+}
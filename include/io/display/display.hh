@@ -1,20 +1,43 @@
 #pragma once
 
+#include "arena.hh"
+#include "frame_sink.hh"
 #include "io/dma/dma.hh"
 #include "io/system/system.hh"
 #include "memory.hh"
+#include "pixel_format.hh"
 #include "registers.hh"
 #include "scheduler.hh"
+#include "tile_cache.hh"
+#include "util/state.hh"
+#include <chrono>
+#include <span>
 
 // NOLINTBEGIN(cppcoreguidelines-avoid-c-arrays)
 namespace matar {
 namespace display {
+// Which frames get their pixels drawn. Skipped frames keep all of their
+// timing, interrupts and DMA, only rendering and handing out the frame is
+// left out.
+struct FrameSkip {
+    // draw one frame out of every this many, none at all if 0
+    uint32_t every = 1;
+
+    // If set, frames are only skipped while emulation runs behind this much
+    // host time per frame, and every becomes the most frames skipped in a
+    // row plus one, so nothing is skipped unless every is above 1.
+    std::chrono::nanoseconds budget{ 0 };
+};
+
 class Display {
     using u16 = uint16_t;
     using u8  = uint8_t;
 
   public:
-    Display(Scheduler& scheduler, System& system, Dma& dma);
+    Display(Scheduler& scheduler,
+            System& system,
+            Dma& dma,
+            MemoryArena* arena = nullptr);
 
     auto& get_pram() { return pram; }
     const auto& get_pram() const { return pram; }
@@ -34,6 +57,47 @@ class Display {
     void vblank_begin();
     void vblank_end();
 
+    void oam_written() {
+        objects_dirty = true;
+        oam_generation++;
+    }
+    void vram_written(uint32_t address) {
+        tiles.invalidate(address);
+        vram_generation[vram_region(address)]++;
+    }
+    void pram_written(uint32_t address);
+
+    // Registers, memory and where the frame is at. What is kept from them to
+    // draw faster is worked out again when loading, and the next lines are
+    // all drawn in full.
+    void save(StateWriter& state) const;
+    void load(StateReader& state);
+
+    // format of the frames rendered from now on
+    void set_pixel_format(PixelFormat format) { pixel_format = format; }
+    PixelFormat get_pixel_format() const { return pixel_format; }
+
+    // every frame is handed to the sink when VBlank starts, on a thread of
+    // its own if threaded, nothing is handed out without a sink
+    void set_frame_sink(FrameSink* sink, bool threaded = false);
+
+    void set_frame_skip(const FrameSkip& skip);
+
+    struct LineStats {
+        uint64_t drawn  = 0;
+        // lines left as they were in the last frame as nothing they are drawn
+        // from changed
+        uint64_t reused = 0;
+    };
+
+    const LineStats& line_stats() const { return line_counts; }
+
+    // frames a threaded sink did not keep up with
+    uint64_t dropped_frames() const { return frame_buffers.dropped(); }
+
+    // number of VBlanks started so far
+    uint64_t frame_count() const { return frames; }
+
     size_t obj_offset() {
         if (lcd_control.value.mode >= 3) {
             return OBJ_START_BITMAP_MODE;
@@ -51,43 +115,132 @@ class Display {
     static constexpr uint32_t VRAM_SIZE = 0x18000;
     static constexpr uint32_t OAM_SIZE  = 0x400;
 
-    Memory<PRAM_SIZE> pram = {};
-    Memory<VRAM_SIZE> vram = {};
-    Memory<OAM_SIZE> oam   = {};
+    Memory<PRAM_SIZE> pram;
+    Memory<VRAM_SIZE> vram;
+    Memory<OAM_SIZE> oam;
+
+    TileCache tiles;
+
+    // PRAM with the unused top bit cleared, kept in step with writes to it
+    alignas(64) std::array<u16, PRAM_SIZE / 2> palette = {};
+
+    uint64_t frames = 0;
 
     /* registers */
-    DisplayControl lcd_control;
-    DisplayStatus lcd_status;
-    u16 vertical_counter;
-    BackgroundControl bg_control[4];
-    Vec2<u16> bg_offset[4];
-    RotationScaling bg2_rot_scale;
-    RotationScaling bg3_rot_scale;
-    Vec2<u8> win0_top_left;
-    Vec2<u8> win0_bot_right;
-    Vec2<u8> win1_top_left;
-    Vec2<u8> win1_bot_right;
-    WindowControl win0;
-    WindowControl win1;
-    WindowControl win_out;
-    WindowControl win_obj;
-    u16 mosaic_size;
-    BlendControl blend_control;
-    BlendAlpha alpha_coeff;
-    u8 brightness_coeff;
+    DisplayControl lcd_control      = {};
+    DisplayStatus lcd_status        = {};
+    u16 vertical_counter            = 0;
+    BackgroundControl bg_control[4] = {};
+    Vec2<u16> bg_offset[4]          = {};
+    RotationScaling bg2_rot_scale   = {};
+    RotationScaling bg3_rot_scale   = {};
+    Vec2<u8> win0_top_left          = {};
+    Vec2<u8> win0_bot_right         = {};
+    Vec2<u8> win1_top_left          = {};
+    Vec2<u8> win1_bot_right         = {};
+    WindowControl win0              = {};
+    WindowControl win1              = {};
+    WindowControl win_out           = {};
+    WindowControl win_obj           = {};
+    u16 mosaic_size                 = 0;
+    BlendControl blend_control      = {};
+    BlendAlpha alpha_coeff          = {};
+    u8 brightness_coeff             = 0;
 
     static constexpr uint32_t OBJ_START_BITMAP_MODE = 0x14000;
     static constexpr uint32_t OBJ_START_TEXT_MODE   = 0x10000;
 
-    // 1 color is 16 bits in ARGB555 format
-    std::array<std::array<Color, LCD_WIDTH>, N_BACKGROUNDS> scanline_buffers;
-    std::array<std::array<ObjectPixel, LCD_HEIGHT>, LCD_WIDTH> object_buffer;
-    std::array<uint16_t, LCD_WIDTH * LCD_HEIGHT> frame_buffer;
+    // 1 color is 16 bits in ARGB555 format, alpha set means transparent
+    std::array<std::array<u16, LCD_WIDTH>, N_BACKGROUNDS> scanline_buffers;
+    std::array<ObjectPixel, LCD_WIDTH> object_buffer;
+
+    static constexpr int N_OBJECTS = 128;
+
+    // OAM indices of the objects covering each line, in OAM order, rebuilt
+    // before rendering a line if OAM was written to since
+    std::array<std::array<uint8_t, N_OBJECTS>, LCD_HEIGHT> line_objects;
+    std::array<uint8_t, LCD_HEIGHT> line_object_count = {};
+    bool objects_dirty                                = true;
+    PixelFormat pixel_format = PixelFormat::RGB555;
+    TripleBuffer frame_buffers;
+    FrameSink* sink = nullptr;
+    std::unique_ptr<SinkThread> sink_thread;
+
+    FrameSkip frame_skip;
+    bool render_frame       = true;
+    uint32_t skipped_frames = 0;
+    /* host time the adaptive frame skip measures from */
+    std::chrono::steady_clock::time_point budget_start;
+    uint64_t budget_frames = 0;
+
+    bool render_next_frame();
+
+    // what the layer registers say about every line, rebuilt when DISPCNT,
+    // BGxCNT, WININ, WINOUT or BLDCNT are written rather than for each line
+    struct LayerState {
+        // backgrounds the mode draws and are enabled, front to back
+        std::array<uint8_t, N_BACKGROUNDS> order;
+        uint8_t count;
+
+        // enable bits of window 0, window 1 and the object window
+        uint8_t windows;
+        // WIN0, WIN1, WINOUT and OBJWIN control, in that order
+        std::array<uint8_t, 4> window_controls;
+
+        // priority of each layer, objects are listed at 0 and the backdrop
+        // behind everything
+        std::array<uint8_t, N_BACKGROUNDS + 2> priorities;
+
+        uint8_t first_targets;
+        uint8_t second_targets;
+        uint8_t effects;
+    };
+
+    LayerState layers;
+
+    void update_layers();
+
+    /* count writes that changed VRAM, PRAM and OAM, so that a line can tell
+     * if what it is drawn from changed without looking at it */
+    enum VramRegion {
+        BgVram,      // 0x00000 - 0x0FFFF
+        SharedVram,  // 0x10000 - 0x13FFF, objects in text modes
+        ObjVram,     // 0x14000 - 0x17FFF
+    };
+
+    static constexpr VramRegion vram_region(uint32_t address) {
+        return address < OBJ_START_TEXT_MODE      ? BgVram
+               : address < OBJ_START_BITMAP_MODE ? SharedVram
+                                                  : ObjVram;
+    }
+
+    std::array<uint64_t, 3> vram_generation = {};
+    std::array<uint64_t, 2> pram_generation = {};
+    uint64_t oam_generation                 = 0;
+
+    // everything a line is drawn from, registers are compared by value as
+    // games tend to write the same values to them every frame
+    struct LineInputs {
+        /* generations of the memory the line reads, 0 where it reads none */
+        std::array<uint64_t, 3> vram;
+        std::array<uint64_t, 2> pram;
+        uint64_t oam;
+
+        std::array<uint32_t, 20> registers;
+
+        /* never matches an actual format until the line is drawn */
+        uint32_t format = UINT32_MAX;
+
+        bool operator==(const LineInputs&) const = default;
+    };
+
+    std::array<LineInputs, LCD_HEIGHT> drawn_inputs;
+    LineStats line_counts;
+    /* the last frame drawn, lines not drawn again are taken from it */
+    const uint8_t* previous_frame = nullptr;
+
+    LineInputs line_inputs() const;
 
-    uint8_t read_color_index(size_t address,
-                             size_t x,
-                             size_t y,
-                             ColorDepth depth);
     Color fetch_color(uint32_t index, uint8_t bank, bool obj);
 
     template<int MODE,
@@ -134,10 +287,24 @@ class Display {
     OamAttributes read_oam_attributes(int idx);
     Vec2<int32_t> object_size(const OamAttributes& o);
     RotationParams read_rotation_params(const OamAttributes& o);
+    bool object_bounds(const OamAttributes& o,
+                       Vec2<int32_t>& pos,
+                       Vec2<int32_t>& display_size);
+    void scan_objects();
     void render_one_object(int idx);
     void render_objects_line();
 
     void render_line();
+
+    // draws the current line, unless it would come out the same as in the
+    // last frame drawn
+    void update_line();
+
+    // resolves the layers of the current line into the frame buffer
+    void compose_line();
+
+    // converts a line of GBA colors to the pixel format into the frame buffer
+    void write_line(std::span<const u16, LCD_WIDTH> colors);
 };
 }
 }
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "pixel_format.hh"
+#include "registers.hh"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+
+namespace matar {
+namespace display {
+struct Frame {
+    // rows of width pixels, pitch bytes apart
+    std::span<const uint8_t> pixels;
+    PixelFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;
+
+    // number of the VBlank that completed this frame, starting at 1
+    uint64_t number;
+};
+
+// something that wants finished frames
+class FrameSink {
+  public:
+    virtual ~FrameSink() = default;
+
+    // the frame is only valid for the duration of the call
+    virtual void consume(const Frame& frame) = 0;
+};
+
+class NullSink : public FrameSink {
+  public:
+    void consume(const Frame&) override {}
+};
+
+// appends the pixels of every frame to a file
+class RawFileSink : public FrameSink {
+  public:
+    explicit RawFileSink(const std::string& path);
+    ~RawFileSink() override;
+
+    RawFileSink(const RawFileSink&)            = delete;
+    RawFileSink& operator=(const RawFileSink&) = delete;
+
+    void consume(const Frame& frame) override;
+
+  private:
+    std::FILE* file;
+};
+
+// Three frame buffers rotating between the renderer and one consumer. The
+// renderer always has a buffer to draw into and the consumer always holds on
+// to the last frame it took, so nothing is copied and neither side waits. If
+// the consumer is slow, frames it did not get to in time are dropped in
+// favour of the newest.
+class TripleBuffer {
+  public:
+    static constexpr uint32_t FRAME_SIZE =
+      LCD_WIDTH * LCD_HEIGHT * bytes_per_pixel(PixelFormat::RGBA8888);
+
+    TripleBuffer();
+
+    /* renderer side */
+    uint8_t* back() { return (*buffers)[back_index].data(); }
+    void publish(PixelFormat format, uint64_t number);
+
+    /* consumer side */
+    // the newest frame if one was published since the last call, it stays
+    // valid until the next call
+    const Frame* acquire();
+
+    // frames published that were never acquired
+    uint64_t dropped() const { return drops.load(); }
+
+  private:
+    static constexpr uint8_t FRESH = 1 << 2;
+
+    std::unique_ptr<std::array<std::array<uint8_t, FRAME_SIZE>, 3>> buffers;
+    std::array<Frame, 3> frames;
+
+    uint8_t back_index  = 0;
+    uint8_t front_index = 1;
+    // index of the buffer in between, with FRESH set if not yet acquired
+    std::atomic<uint8_t> middle = 2;
+
+    std::atomic<uint64_t> drops = 0;
+};
+
+// hands the frames of a triple buffer to a sink on a thread of its own
+class SinkThread {
+  public:
+    SinkThread(TripleBuffer& buffers, FrameSink& sink);
+    ~SinkThread();
+
+    SinkThread(const SinkThread&)            = delete;
+    SinkThread& operator=(const SinkThread&) = delete;
+
+    // a frame was published
+    void notify() {
+        wakeups.fetch_add(1);
+        wakeups.notify_one();
+    }
+
+  private:
+    TripleBuffer& buffers;
+    FrameSink& sink;
+    std::atomic<uint64_t> wakeups = 0;
+    std::atomic<bool> stopping    = false;
+    std::thread thread;
+
+    void run();
+};
+}
+}
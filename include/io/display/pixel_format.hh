@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+namespace matar {
+namespace display {
+// layout of the pixels handed out in a frame, the 8888 formats are named in
+// byte order
+enum class PixelFormat {
+    RGB555, // as the GBA stores it, red in the low bits
+    RGB565, // red in the high bits
+    RGBA8888,
+    BGRA8888
+};
+
+constexpr uint32_t
+bytes_per_pixel(PixelFormat format) {
+    return format == PixelFormat::RGB555 || format == PixelFormat::RGB565 ? 2
+                                                                          : 4;
+}
+
+template<PixelFormat FORMAT>
+using HostPixel =
+  std::conditional_t<bytes_per_pixel(FORMAT) == 2, uint16_t, uint32_t>;
+
+// converts a GBA color to the host format
+template<PixelFormat FORMAT>
+constexpr HostPixel<FORMAT>
+to_host_pixel(uint16_t color) {
+    const uint32_t red   = color & 0x1F;
+    const uint32_t green = color >> 5 & 0x1F;
+    const uint32_t blue  = color >> 10 & 0x1F;
+
+    /* widen by repeating the top bits so that 0x1F becomes all ones */
+    auto widen8 = [](uint32_t c) { return c << 3 | c >> 2; };
+
+    if constexpr (FORMAT == PixelFormat::RGB555) {
+        return color;
+    } else if constexpr (FORMAT == PixelFormat::RGB565) {
+        return red << 11 | (green << 1 | green >> 4) << 5 | blue;
+    } else if constexpr (FORMAT == PixelFormat::RGBA8888) {
+        return widen8(red) | widen8(green) << 8 | widen8(blue) << 16 |
+               0xFFu << 24;
+    } else {
+        return widen8(blue) | widen8(green) << 8 | widen8(red) << 16 |
+               0xFFu << 24;
+    }
+}
+
+// the GBA color a pixel of the host format was converted from
+template<PixelFormat FORMAT>
+constexpr uint16_t
+from_host_pixel(HostPixel<FORMAT> pixel) {
+    if constexpr (FORMAT == PixelFormat::RGB555) {
+        return pixel;
+    } else if constexpr (FORMAT == PixelFormat::RGB565) {
+        return (pixel >> 11) | (pixel >> 6 & 0x1F) << 5 | (pixel & 0x1F) << 10;
+    } else if constexpr (FORMAT == PixelFormat::RGBA8888) {
+        return (pixel >> 3 & 0x1F) | (pixel >> 11 & 0x1F) << 5 |
+               (pixel >> 19 & 0x1F) << 10;
+    } else {
+        return (pixel >> 19 & 0x1F) | (pixel >> 11 & 0x1F) << 5 |
+               (pixel >> 3 & 0x1F) << 10;
+    }
+}
+
+static_assert(to_host_pixel<PixelFormat::RGB565>(0x7FFF) == 0xFFFF);
+static_assert(to_host_pixel<PixelFormat::RGB565>(0x001F) == 0xF800);
+static_assert(to_host_pixel<PixelFormat::RGBA8888>(0x001F) == 0xFF0000FF);
+static_assert(to_host_pixel<PixelFormat::BGRA8888>(0x001F) == 0xFFFF0000);
+static_assert(to_host_pixel<PixelFormat::BGRA8888>(0x7C00) == 0xFF0000FF);
+static_assert(from_host_pixel<PixelFormat::RGB565>(
+                to_host_pixel<PixelFormat::RGB565>(0x1234)) == 0x1234);
+static_assert(from_host_pixel<PixelFormat::RGBA8888>(
+                to_host_pixel<PixelFormat::RGBA8888>(0x4321)) == 0x4321);
+static_assert(from_host_pixel<PixelFormat::BGRA8888>(
+                to_host_pixel<PixelFormat::BGRA8888>(0x4321)) == 0x4321);
+}
+}
@@ -58,14 +58,6 @@ struct Color {
                ((blue & 0b11111) << 10) | (alpha << 15);
     }
 
-    Color blend(Color o, uint8_t eva, uint8_t evb) {
-        uint8_t red   = std::min(31, (this->red * eva + o.red * evb) / 16);
-        uint8_t green = std::min(31, (this->green * eva + o.green * evb) / 16);
-        uint8_t blue  = std::min(31, (this->blue * eva + o.blue * evb) / 16);
-
-        return Color(red, green, blue);
-    }
-
   private:
     uint8_t red;
     uint8_t green;
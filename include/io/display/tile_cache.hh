@@ -0,0 +1,80 @@
+#pragma once
+
+#include "registers.hh"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace matar {
+namespace display {
+// Tiles of VRAM expanded to one color index per byte, along with their
+// horizontally flipped copies. Tiles are decoded the first time they are
+// needed after a write to VRAM touched them.
+class TileCache {
+  public:
+    static constexpr uint32_t TILE_SIZE = 8;
+
+    explicit TileCache(std::span<const uint8_t> vram);
+
+    // 8 color indices of row y of the tile starting at address
+    const uint8_t* row(uint32_t address,
+                       ColorDepth depth,
+                       bool mirrorx,
+                       uint32_t y) {
+        uint32_t slot = address / SLOT_SIZE;
+
+        if (slot >= slots) [[unlikely]] {
+            return BLANK_ROW.data();
+        }
+
+        const uint8_t bit = 1 << depth;
+        DecodedTile& tile =
+          depth == ColorDepth::BPP8 ? tiles8[slot] : tiles4[slot];
+
+        if (!(valid[slot] & bit)) [[unlikely]] {
+            decode(slot, depth);
+            valid[slot] |= bit;
+        }
+
+        return &tile[(mirrorx ? TILE_PIXELS : 0) + y * TILE_SIZE];
+    }
+
+    // a write to VRAM at address, either 2 or 4 bytes wide
+    void invalidate(uint32_t address) {
+        uint32_t slot = address / SLOT_SIZE;
+
+        valid[slot] = 0;
+
+        /* 8bpp tiles span the next slot as well */
+        if (slot > 0) {
+            valid[slot - 1] &= ~(1 << ColorDepth::BPP8);
+        }
+    }
+
+    void invalidate_all() { std::fill(valid.begin(), valid.end(), 0); }
+
+  private:
+    /* tiles can start at any multiple of 32 bytes, the size of a 4bpp tile */
+    static constexpr uint32_t SLOT_SIZE   = 32;
+    static constexpr uint32_t TILE_PIXELS = TILE_SIZE * TILE_SIZE;
+
+    static constexpr std::array<uint8_t, TILE_SIZE> BLANK_ROW = {};
+
+    using DecodedTile = std::array<uint8_t, TILE_PIXELS * 2>;
+
+    std::span<const uint8_t> vram;
+    uint32_t slots;
+
+    // left uninitialised, a tile is only read once it is decoded, so that
+    // making a cache only costs the pages of the tiles it ends up decoding
+    std::unique_ptr<DecodedTile[]> tiles4;
+    std::unique_ptr<DecodedTile[]> tiles8;
+    std::vector<uint8_t> valid;
+
+    void decode(uint32_t slot, ColorDepth depth);
+};
+}
+}
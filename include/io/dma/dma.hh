@@ -25,22 +25,27 @@ class Dma {
     uint16_t read_halfword(uint32_t address) const;
     void write_halfword(uint32_t address, uint16_t halfword);
 
+    // throws std::runtime_error if the source address control is prohibited
     void start_transfer(uint8_t id);
 
     void notify(DmaControl::Timing timing, uint64_t at);
     void schedule_sound_xfer(uint32_t fifo_addr, uint64_t at);
 
+    // field by field, the padding of the channels is not part of a state
+    void save(StateWriter& state) const;
+    void load(StateReader& state);
+
   private:
     void write_and_eval_ctrl(uint8_t id, uint16_t raw);
 
     struct {
-        u64 timestamp;
+        u64 timestamp = 0;
 
         /* registers */
-        u32 source;
-        u32 destination;
-        u16 word_count;
-        DmaControl control;
+        u32 source         = 0;
+        u32 destination    = 0;
+        u16 word_count     = 0;
+        DmaControl control = {};
     } channels[NUM_DMA_CHANS];
 
     Bus& bus;
@@ -10,8 +10,8 @@
 namespace matar {
 class IoDevices {
   public:
-    IoDevices(Bus& bus, Scheduler& scheduler)
-      : display(scheduler, system, dma)
+    IoDevices(Bus& bus, Scheduler& scheduler, MemoryArena* arena = nullptr)
+      : display(scheduler, system, dma, arena)
       , sound(dma, scheduler, 44100)
       , dma(bus, scheduler, system)
       , timer(scheduler, system, sound)
@@ -37,8 +37,39 @@ class IoDevices {
 
     size_t obj_offset() {return display.obj_offset();}
 
+    void oam_written() { display.oam_written(); }
+    void vram_written(uint32_t address) { display.vram_written(address); }
+    void pram_written(uint32_t address) { display.pram_written(address); }
+
+    void set_pixel_format(display::PixelFormat format) {
+        display.set_pixel_format(format);
+    }
+
+    void set_frame_sink(display::FrameSink* sink, bool threaded) {
+        display.set_frame_sink(sink, threaded);
+    }
+
+    void set_frame_skip(const display::FrameSkip& skip) {
+        display.set_frame_skip(skip);
+    }
+
+    void set_sound_output(bool enable) { sound.set_output(enable); }
+    void set_sample_hashing(bool enable) { sound.set_sample_hashing(enable); }
+    uint64_t take_sample_hash() { return sound.take_sample_hash(); }
+
+    void set_keys(uint16_t pressed) { system.set_keys(pressed); }
+
+    uint64_t frame_count() const { return display.frame_count(); }
+
+    const display::Display::LineStats& line_stats() const {
+        return display.line_stats();
+    }
+
     void scheduler_event(Task::Type type, uint64_t at);
 
+    void save(StateWriter& state) const;
+    void load(StateReader& state);
+
     bool any_is_interrupt_pending() { return system.any_irq_is_pending(); }
 
   private:
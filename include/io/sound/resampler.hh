@@ -2,6 +2,7 @@
 
 #include "io/sound/buffer.hh"
 #include "io/sound/registers.hh"
+#include "util/state.hh"
 
 #include <cmath>
 #include <numbers>
@@ -42,6 +43,19 @@ class Resampler {
     }
     uint32_t get_freq_in() const { return static_cast<uint32_t>(freq_in); }
 
+    // the output rate belongs to the host, it is left as it is
+    void save(StateWriter& state) const {
+        state.put(freq_in);
+        state.put(phase);
+        state.put(s0);
+    }
+
+    void load(StateReader& state) {
+        state.get(freq_in);
+        state.get(phase);
+        state.get(s0);
+    }
+
   private:
     float freq_in;
     float freq_out;
@@ -5,6 +5,8 @@
 #include "io/sound/resampler.hh"
 #include "scheduler.hh"
 #include <cstdint>
+#include <queue>
+#include <utility>
 #include <io/sound/registers.hh>
 
 namespace matar {
@@ -24,6 +26,24 @@ class SoundFIFO {
         fifo.push((int8_t)((h >> 8) & 0xFF));
     }
 
+    void save(StateWriter& state) const {
+        std::queue<int8_t> bytes = fifo;
+
+        state.put(bytes.size());
+
+        for (; !bytes.empty(); bytes.pop()) {
+            state.put(bytes.front());
+        }
+    }
+
+    void load(StateReader& state) {
+        fifo = {};
+
+        for (size_t n = state.get<size_t>(); n > 0; n--) {
+            fifo.push(state.get<int8_t>());
+        }
+    }
+
     int8_t read() {
         if (fifo.empty()) {
             return 0;
@@ -59,47 +79,80 @@ class Sound {
     void write_halfword(u32 address, u16 value);
 
     void dma_playback(uint8_t timer_id, uint64_t at);
+
+    // bitmask of the timers whose overflows feed the FIFOs
+    uint8_t fifo_timers() const {
+        if (!sound_on_off.value.psg_fifo_master_ena) {
+            return 0;
+        }
+
+        return 1 << dma_ctrl.value.dma_a_timer_sel |
+               1 << dma_ctrl.value.dma_b_timer_sel;
+    }
     void sample(uint64_t at);
 
+    // mixing and resampling can be left out when nobody listens, the FIFOs
+    // are still fed and drained as the game expects
+    void set_output(bool enable);
+
+    // the output settings are left as they are, and are not part of a state
+    void save(StateWriter& state) const;
+    void load(StateReader& state);
+
+    // keep a hash of the samples made, before they are resampled
+    void set_sample_hashing(bool enable) {
+        hash_samples = enable;
+        sample_hash  = 0;
+    }
+
+    // hash of the samples made since the last call
+    uint64_t take_sample_hash() { return std::exchange(sample_hash, 0); }
+
   private:
     // channel 1
-    Ch1Sweep ch1_sweep;
-    Ch1Envelope ch1_envelope;
-    Ch1FrequencyControl ch1_freq_ctrl;
+    Ch1Sweep ch1_sweep                = {};
+    Ch1Envelope ch1_envelope          = {};
+    Ch1FrequencyControl ch1_freq_ctrl = {};
 
     // 75726
     // channel 2
-    Ch2Envelope ch2_envelope;
-    Ch2FrequencyControl ch2_freq_ctrl;
+    Ch2Envelope ch2_envelope          = {};
+    Ch2FrequencyControl ch2_freq_ctrl = {};
 
     // channel 3
-    Ch3WaveSelect ch3_wave_select;
-    Ch3LengthVolume ch3_len_vol;
-    Ch3FrequencyControl ch3_freq_ctrl;
-    uint16_t ch3_wave_pattern[8];
+    Ch3WaveSelect ch3_wave_select     = {};
+    Ch3LengthVolume ch3_len_vol       = {};
+    Ch3FrequencyControl ch3_freq_ctrl = {};
+    uint16_t ch3_wave_pattern[8]      = {};
 
     // channel 4
-    Ch4Envelope ch4_envelope;
-    Ch4FrequencyControl ch4_freq_ctrl;
+    Ch4Envelope ch4_envelope          = {};
+    Ch4FrequencyControl ch4_freq_ctrl = {};
 
     // control
-    LRVolumeControl vol_ctrl;
-    DmaControl dma_ctrl;
-    SoundOnOff sound_on_off;
-    SoundBias sound_bias;
+    LRVolumeControl vol_ctrl = {};
+    DmaControl dma_ctrl      = {};
+    SoundOnOff sound_on_off  = {};
+    SoundBias sound_bias     = {};
 
     // fifo
     SoundFIFO fifo_a;
     SoundFIFO fifo_b;
 
-    int8_t dma_value_a;
-    int8_t dma_value_b;
+    int8_t dma_value_a = 0;
+    int8_t dma_value_b = 0;
 
     Dma& dma;
     Scheduler& scheduler;
     uint32_t sampling_rate;
     Resampler resampler;
     AudioBuffer buffer;
+
+    bool output   = true;
+    bool sampling = true;
+
+    bool hash_samples    = false;
+    uint64_t sample_hash = 0;
 };
 // NOLINTEND(cppcoreguidelines-avoid-c-arrays)
 }
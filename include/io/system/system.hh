@@ -2,6 +2,7 @@
 
 #include "../../../src/util/log.hh"
 #include "registers.hh"
+#include "util/state.hh"
 #include <cstdint>
 #include <cstdio>
 
@@ -38,18 +39,27 @@ class System {
         interrupt_request_flags |= 1 << static_cast<uint8_t>(event);
     }
 
+    // keys held down, a bit each in KEYINPUT order: A, B, Select, Start,
+    // Right, Left, Up, Down, R and L
+    void set_keys(uint16_t pressed);
+
+    void save(StateWriter& state) const;
+    void load(StateReader& state);
+
     bool any_irq_is_pending() {
         return interrupt_master_enabler &
                !!(interrupt_enable & interrupt_request_flags);
     }
 
   private:
-    uint16_t interrupt_enable;
-    uint16_t interrupt_request_flags;
-    bool interrupt_master_enabler;
-    bool post_boot_flag;
-    WaitstateControl waitstate_control;
-    bool low_power_mode;
+    uint16_t interrupt_enable          = 0;
+    uint16_t interrupt_request_flags   = 0;
+    bool interrupt_master_enabler      = false;
+    bool post_boot_flag                = false;
+    WaitstateControl waitstate_control = {};
+    bool low_power_mode                = false;
+    uint16_t keys_pressed              = 0;
+    uint16_t key_control               = 0;
 
     Bus& bus;
 };
@@ -10,6 +10,10 @@ namespace matar {
 // NOLINTBEGIN(cppcoreguidelines-avoid-c-arrays)
 static constexpr int NUM_TIMERS = 4;
 
+// Counters are not stepped, they are computed from the cycle they were last
+// latched at whenever they are read. Overflow events are only scheduled for
+// timers whose overflows someone can see: an IRQ, the sound FIFOs, or a
+// cascade into a timer that is itself observed.
 class Timer {
     using u16 = uint16_t;
 
@@ -24,15 +28,43 @@ class Timer {
 
     void trigger_overflow(uint8_t id, uint64_t at);
 
+    // re-evaluate which timers need overflow events, i.e, after the sound
+    // FIFO timer selection changed
+    void reschedule();
+
+    // Overflows waiting in the scheduler are saved along with it. Field by
+    // field, the padding of the timers is not part of a state.
+    void save(StateWriter& state) const;
+    void load(StateReader& state);
+
   private:
+    static constexpr uint64_t NONE = UINT64_MAX;
+
     struct {
-        u16 counter;
-        u16 reload;
-        TimerControl control;
+        u16 counter          = 0;    // value at epoch
+        u16 reload           = 0;
+        TimerControl control = {};
+        uint64_t epoch       = 0;    // cycle the counter was latched at
+        uint64_t scheduled   = NONE; // pending overflow event
     } timers[NUM_TIMERS];
 
+    bool cascades(uint8_t id) const {
+        return id != 0 && timers[id].control.value.count_up;
+    }
+
+    bool observed(uint8_t id) const;
+
+    uint64_t ticks(uint8_t id, uint64_t now) const;
+    uint64_t overflows(uint8_t id, uint64_t now) const;
+    u16 counter(uint8_t id, uint64_t now) const;
+    uint64_t next_overflow(uint8_t id, uint64_t now) const;
+
+    // fire the overflows up to now and latch all counters
+    void latch(uint64_t now);
+    void reschedule(uint64_t now);
+
     void write_and_eval_ctrl(uint8_t id, u16 raw);
-    void schedule_overflow(uint8_t id, uint64_t at);
+    void write_reload(uint8_t id, u16 raw);
 
     Scheduler& scheduler;
     System& irq;
@@ -3,19 +3,54 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
 #include <vector>
 
 namespace matar {
 template<std::size_t N = 0>
 class Memory {
-    // we can use either a vector or an array with this
-    using Container = std::
-      conditional_t<(N != 0), std::array<uint8_t, N>, std::vector<uint8_t>>;
+    // always a view, into a block of a fixed size or a vector of any size,
+    // either held here or owned by someone else
+    using Container = std::span<uint8_t, (N != 0) ? N : std::dynamic_extent>;
+    using Storage =
+      std::conditional_t<(N != 0),
+                         std::unique_ptr<std::array<uint8_t, N>>,
+                         std::vector<uint8_t>>;
 
   public:
-    Memory() = default;
-    Memory(auto x)
-      : memory(x) {}
+    Memory()
+        requires(N != 0)
+      : storage(std::make_unique<std::array<uint8_t, N>>())
+      , memory(*storage) {}
+
+    Memory()
+        requires(N == 0)
+    = default;
+
+    // views into memory owned by someone else, i.e, a MemoryArena
+    explicit Memory(std::span<uint8_t, N> view)
+        requires(N != 0)
+      : memory(view) {}
+
+    Memory(std::array<uint8_t, N>&& x)
+        requires(N != 0)
+      : storage(std::make_unique<std::array<uint8_t, N>>(x))
+      , memory(*storage) {}
+
+    explicit Memory(std::span<uint8_t> view)
+        requires(N == 0)
+      : memory(view) {}
+
+    Memory(std::vector<uint8_t>&& x)
+        requires(N == 0)
+      : storage(std::move(x))
+      , memory(storage) {}
+
+    // a copy would be a view into the memory it was copied from
+    Memory(Memory&&)            = default;
+    Memory& operator=(Memory&&) = default;
 
     uint8_t read_byte(std::size_t idx) const { return memory[idx]; }
 
@@ -41,13 +76,15 @@ class Memory {
         std::memcpy(&memory[idx], &word, 4);
     }
 
-    uint8_t& operator[](std::size_t idx) { return memory.at(idx); }
+    uint8_t& operator[](std::size_t idx) { return memory[idx]; }
 
     Container& data() { return memory; }
+    const Container& data() const { return memory; }
 
     constexpr std::size_t size() const { return memory.size(); }
 
   private:
+    [[no_unique_address]] Storage storage;
     Container memory;
 };
 }
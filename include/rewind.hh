@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace matar {
+class Bus;
+class Cpu;
+
+struct RewindConfig {
+    // frames between states
+    uint32_t interval = 60;
+    // bytes the rewind may hold: the history, the newest state, the depth
+    // states waiting to be compressed and the room to compress them in
+    size_t budget = 32 * 1024 * 1024;
+    // states waiting to be compressed before more are dropped
+    uint32_t depth = 4;
+};
+
+// History of the machine to go back to, a savestate every few frames. Only
+// the newest state is kept whole, every older one is kept as how it differs
+// from the one after it: the XOR of the two, which is zero wherever memory
+// did not change, with the runs of zeroes left out. Those are worked out on a
+// thread of the rewind's, so a capture only costs the frame a savestate.
+// Going back a few states only undoes as many deltas, and the oldest states
+// are forgotten to stay within the budget.
+class Rewind {
+  public:
+    Rewind(Bus& bus, Cpu& cpu, RewindConfig config = {});
+    ~Rewind();
+
+    Rewind(const Rewind&)            = delete;
+    Rewind& operator=(const Rewind&) = delete;
+
+    // to be called after every frame, captures a state every interval frames
+    void frame();
+
+    // Goes back to the state captured steps states before the newest one,
+    // and forgets the ones after it. Throws std::out_of_range if there are
+    // not that many.
+    void restore(size_t steps = 0);
+
+    // states there are to go back to
+    size_t states() const;
+
+    // bytes held, counted as the budget is
+    size_t memory() const;
+
+    // captures that came while the thread was still busy with earlier ones
+    uint64_t dropped() const { return drops; }
+
+  private:
+    Bus& bus;
+    Cpu& cpu;
+    const RewindConfig config;
+    uint32_t frames = 0;
+
+    /* captured states, by slot, waiting for the thread and done with */
+    struct Queues;
+    std::vector<std::vector<uint8_t>> captures;
+    std::unique_ptr<Queues> queues;
+    uint64_t submitted = 0;
+    uint64_t drops     = 0;
+
+    /* the newest state is only touched by the thread, or once it is done
+     * with everything submitted */
+    std::vector<uint8_t> newest;
+    std::vector<uint8_t> scratch;
+
+    /* oldest first, each turns the state after it into its own */
+    mutable std::mutex lock;
+    std::deque<std::vector<uint8_t>> deltas;
+    size_t kept = 0;
+    /* the capture slots and scratch, as big as they can get */
+    size_t buffers = 0;
+
+    std::atomic<uint64_t> finished = 0;
+    std::atomic<uint64_t> wakeups  = 0;
+    std::atomic<bool> stopping     = false;
+    std::thread thread;
+
+    void run();
+    void compress(std::vector<uint8_t>& state);
+    void wait();
+};
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace matar {
+class Bus;
+class Cpu;
+
+// Savestates hold the whole machine but the BIOS and the ROM, and only load
+// into a machine running the ROM they were saved from with the same kind of
+// scheduler. The state is laid out the way the build that saved it lays the
+// machine out in memory, the version goes up whenever that changes.
+static constexpr uint32_t SAVESTATE_VERSION = 3;
+
+// the kind of scheduler this build saves states with, heap or wheel
+std::string_view
+savestate_scheduler();
+
+// Writes a savestate to out, replacing what it held. Saving into the same
+// buffer over and over does not allocate once it is big enough.
+void
+save_state(const Bus& bus, const Cpu& cpu, std::vector<uint8_t>& out);
+std::vector<uint8_t>
+save_state(const Bus& bus, const Cpu& cpu);
+
+// Throws std::invalid_argument, leaving the machine as it was, if the state
+// is not one that can be loaded into it. Lines of the frame being drawn that
+// come before the current one are left as they were drawn before loading.
+void
+load_state(Bus& bus, Cpu& cpu, std::span<const uint8_t> state);
+
+void
+save_state_file(const Bus& bus, const Cpu& cpu, const std::string& path);
+void
+load_state_file(Bus& bus, Cpu& cpu, const std::string& path);
+}
@@ -1,8 +1,13 @@
 #pragma once
 
 #include "../../src/util/log.hh"
+#include "util/state.hh"
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstdint>
-#include <queue>
+#include <span>
+#include <vector>
 
 namespace matar {
 
@@ -25,9 +30,264 @@ struct Task {
     uint64_t cycles;
 
     bool operator<(const Task& other) const { return cycles > other.cycles; }
+
+    // field by field, so that padding copied around with tasks never makes
+    // its way into a state
+    void save(StateWriter& state) const {
+        state.put(type);
+        state.put(cycles);
+    }
+
+    static Task load(StateReader& state) {
+        Task task;
+        state.get(task.type);
+        state.get(task.cycles);
+        return task;
+    }
 };
 
-class Scheduler {
+// binary heap, O(log n) insert and pop
+class HeapQueue {
+  public:
+    void push(Task task) {
+        tasks.push_back(task);
+        std::push_heap(tasks.begin(), tasks.end());
+    }
+
+    bool empty() const { return tasks.empty(); }
+
+    Task top() const { return tasks.front(); }
+
+    void pop() {
+        std::pop_heap(tasks.begin(), tasks.end());
+        tasks.pop_back();
+    }
+
+    // every task waiting, in no particular order
+    std::span<const Task> pending() const { return tasks; }
+
+    // the heap is kept as it is, so that tasks due at the same cycle come
+    // out in the same order after loading
+    void save(StateWriter& state) const {
+        state.put(tasks.size());
+
+        for (const Task& task : tasks) {
+            task.save(state);
+        }
+    }
+
+    void load(StateReader& state) {
+        tasks.resize(state.get<size_t>());
+
+        for (Task& task : tasks) {
+            task = Task::load(state);
+        }
+    }
+
+  private:
+    std::vector<Task> tasks;
+};
+
+// Timing wheel with one slot per cycle covering the next SLOTS cycles from the
+// last popped event, O(1) insert and pop. Events outside of that window (far
+// timers, or anything scheduled in the past) go to an overflow heap.
+class TimingWheel {
+  public:
+    static constexpr uint32_t SLOTS = 4096;
+
+    void push(Task task) {
+        if (task.cycles < base || task.cycles - base >= SLOTS) {
+            overflow.push(task);
+            return;
+        }
+
+        uint32_t node = alloc(task);
+        uint32_t slot = task.cycles & MASK;
+
+        if (head[slot] == NIL) {
+            head[slot] = node;
+            occupy(slot);
+        } else {
+            nodes[tail[slot]].next = node;
+        }
+
+        tail[slot] = node;
+
+        if (count++ == 0 || task.cycles < wheel_min) {
+            wheel_min = task.cycles;
+        }
+    }
+
+    bool empty() const { return count == 0 && overflow.empty(); }
+
+    Task top() const {
+        if (from_wheel()) {
+            return nodes[head[wheel_min & MASK]].task;
+        }
+
+        return overflow.top();
+    }
+
+    void pop() {
+        if (!from_wheel()) {
+            base = std::max(base, overflow.top().cycles);
+            overflow.pop();
+            return;
+        }
+
+        uint32_t slot = wheel_min & MASK;
+        uint32_t node = head[slot];
+
+        base       = wheel_min;
+        head[slot] = nodes[node].next;
+        release(node);
+        count--;
+
+        if (head[slot] != NIL) {
+            return;
+        }
+
+        vacate(slot);
+
+        if (count > 0) {
+            wheel_min = base + ((next_occupied(slot) - slot) & MASK);
+        }
+    }
+
+    // every task waiting, in no particular order
+    std::vector<Task> pending() const {
+        std::vector<Task> tasks(overflow.pending().begin(),
+                                overflow.pending().end());
+
+        for_each_in_wheel(
+          [&tasks](const Task& task) { tasks.push_back(task); });
+        return tasks;
+    }
+
+    // The tasks in the wheel are saved in the order they would be popped
+    // and put back in that order, the overflow heap is saved as it is.
+    void save(StateWriter& state) const {
+        state.put(base);
+        state.put(count);
+        for_each_in_wheel([&state](const Task& task) { task.save(state); });
+        overflow.save(state);
+    }
+
+    void load(StateReader& state) {
+        *this = TimingWheel();
+
+        state.get(base);
+
+        for (size_t i = state.get<size_t>(); i > 0; i--) {
+            push(Task::load(state));
+        }
+
+        overflow.load(state);
+    }
+
+  private:
+    static constexpr uint32_t MASK  = SLOTS - 1;
+    static constexpr uint32_t NIL   = UINT32_MAX;
+    static constexpr uint32_t WORDS = SLOTS / 64;
+
+    static_assert(std::has_single_bit(SLOTS) && WORDS <= 64);
+
+    struct Node {
+        Task task;
+        uint32_t next;
+    };
+
+    // tasks in the wheel, chained per slot in insertion order
+    std::vector<Node> nodes;
+    uint32_t free_list = NIL;
+    std::array<uint32_t, SLOTS> head = make_heads();
+    std::array<uint32_t, SLOTS> tail = {};
+
+    // one bit per occupied slot, and one bit per non empty word of those
+    std::array<uint64_t, WORDS> occupied = {};
+    uint64_t summary                     = 0;
+
+    uint64_t base      = 0;
+    uint64_t wheel_min = 0;
+    size_t count       = 0;
+
+    HeapQueue overflow;
+
+    static constexpr std::array<uint32_t, SLOTS> make_heads() {
+        std::array<uint32_t, SLOTS> heads;
+        heads.fill(NIL);
+        return heads;
+    }
+
+    bool from_wheel() const {
+        return count > 0 &&
+               (overflow.empty() || wheel_min <= overflow.top().cycles);
+    }
+
+    uint32_t alloc(Task task) {
+        if (free_list == NIL) {
+            nodes.push_back({ task, NIL });
+            return nodes.size() - 1;
+        }
+
+        uint32_t node = free_list;
+        free_list     = nodes[node].next;
+        nodes[node]   = { task, NIL };
+        return node;
+    }
+
+    void release(uint32_t node) {
+        nodes[node].next = free_list;
+        free_list        = node;
+    }
+
+    void occupy(uint32_t slot) {
+        occupied[slot / 64] |= 1ULL << (slot % 64);
+        summary |= 1ULL << (slot / 64);
+    }
+
+    void vacate(uint32_t slot) {
+        occupied[slot / 64] &= ~(1ULL << (slot % 64));
+
+        if (occupied[slot / 64] == 0) {
+            summary &= ~(1ULL << (slot / 64));
+        }
+    }
+
+    // visits the tasks in the wheel in the order they would be popped
+    template<typename F>
+    void for_each_in_wheel(F visit) const {
+        for (uint32_t i = 0; i < SLOTS; i++) {
+            for (uint32_t node = head[(base + i) & MASK]; node != NIL;
+                 node          = nodes[node].next) {
+                visit(nodes[node].task);
+            }
+        }
+    }
+
+    // first occupied slot at or after `from`, wrapping around, the wheel must
+    // not be empty
+    uint32_t next_occupied(uint32_t from) const {
+        uint32_t word = from / 64;
+        uint64_t bits = occupied[word] & (~0ULL << (from % 64));
+
+        if (bits != 0) {
+            return word * 64 + std::countr_zero(bits);
+        }
+
+        uint64_t words = word == 63 ? 0 : summary & (~0ULL << (word + 1));
+
+        if (words == 0) {
+            words = summary;
+        }
+
+        word = std::countr_zero(words);
+        return word * 64 + std::countr_zero(occupied[word]);
+    }
+};
+
+template<typename Queue>
+class BasicScheduler {
   public:
     void schedule_at(Task::Type type, uint64_t cycles) {
         tasks.push({ type, cycles });
@@ -47,8 +307,27 @@ class Scheduler {
 
     void pop() { tasks.pop(); }
 
+    // every task waiting, in no particular order
+    auto pending() const { return tasks.pending(); }
+
+    void save(StateWriter& state) const {
+        state.put(cycles);
+        tasks.save(state);
+    }
+
+    void load(StateReader& state) {
+        state.get(cycles);
+        tasks.load(state);
+    }
+
   private:
-    std::priority_queue<Task> tasks;
+    Queue tasks;
     uint64_t cycles = 0;
 };
+
+#ifdef TIMING_WHEEL_SCHEDULER
+using Scheduler = BasicScheduler<TimingWheel>;
+#else
+using Scheduler = BasicScheduler<HeapQueue>;
+#endif
 }
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace matar {
+// Appends state to a buffer as it is laid out in memory. Only states written
+// by the same build are meant to be read back.
+//
+// Guest memory can be left out, for machines that share it with the one the
+// state is read back into, see fork.
+class StateWriter {
+  public:
+    explicit StateWriter(std::vector<uint8_t>& out, bool memory = true)
+      : out(out)
+      , memory(memory) {}
+
+    template<typename T>
+        requires std::is_trivially_copyable_v<T>
+    void put(const T& value) {
+        put_bytes({ reinterpret_cast<const uint8_t*>(&value), sizeof(T) });
+    }
+
+    void put_bytes(std::span<const uint8_t> bytes) {
+        out.insert(out.end(), bytes.begin(), bytes.end());
+    }
+
+    void put_memory(std::span<const uint8_t> bytes) {
+        if (memory) {
+            put_bytes(bytes);
+        }
+    }
+
+  private:
+    std::vector<uint8_t>& out;
+    const bool memory;
+};
+
+// Reads state back in the order it was written, throws if it runs out.
+class StateReader {
+  public:
+    explicit StateReader(std::span<const uint8_t> in, bool memory = true)
+      : in(in)
+      , memory(memory) {}
+
+    template<typename T>
+        requires std::is_trivially_copyable_v<T>
+    void get(T& value) {
+        get_bytes({ reinterpret_cast<uint8_t*>(&value), sizeof(T) });
+    }
+
+    template<typename T>
+        requires std::is_trivially_copyable_v<T>
+    T get() {
+        T value;
+        get(value);
+        return value;
+    }
+
+    void get_bytes(std::span<uint8_t> bytes) {
+        if (bytes.size() > in.size()) {
+            throw std::out_of_range("Savestate ends early");
+        }
+
+        std::memcpy(bytes.data(), in.data(), bytes.size());
+        in = in.subspan(bytes.size());
+    }
+
+    void get_memory(std::span<uint8_t> bytes) {
+        if (memory) {
+            get_bytes(bytes);
+        }
+    }
+
+    // what is left to read
+    size_t remaining() const { return in.size(); }
+
+  private:
+    std::span<const uint8_t> in;
+    const bool memory;
+};
+}
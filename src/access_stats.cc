@@ -0,0 +1,272 @@
+#include "access_stats.hh"
+#include "util/log.hh"
+#include <format>
+#include <fstream>
+
+namespace matar {
+
+static constexpr std::array<uint32_t, AccessStats::N_WIDTHS> WIDTHS = {
+    8, 16, 32
+};
+
+// address space covered by each region, mirrors are folded into this
+static constexpr std::array<uint32_t, AccessStats::N_REGIONS> REGION_SPAN = {
+    16 * 1024,        // BIOS
+    256 * 1024,       // EWRAM
+    32 * 1024,        // IWRAM
+    4 * 1024,         // I/O
+    1024,             // PRAM
+    128 * 1024,       // VRAM
+    1024,             // OAM
+    32 * 1024 * 1024, // ROM
+    64 * 1024,        // SRAM
+    0,                // unmapped
+};
+
+AccessStats::Region
+AccessStats::region(uint32_t address) {
+    switch ((address >> 24) & 0xF) {
+        case 0x0:
+            return Region::Bios;
+        case 0x2:
+            return Region::Ewram;
+        case 0x3:
+            return Region::Iwram;
+        case 0x4:
+            return Region::Io;
+        case 0x5:
+            return Region::Pram;
+        case 0x6:
+            return Region::Vram;
+        case 0x7:
+            return Region::Oam;
+        case 0x8:
+        case 0x9:
+        case 0xA:
+        case 0xB:
+        case 0xC:
+        case 0xD:
+            return Region::Rom;
+        case 0xE:
+            return Region::Sram;
+        default:
+            return Region::Unmapped;
+    }
+}
+
+const char*
+AccessStats::region_name(Region region) {
+    switch (region) {
+        case Region::Bios:
+            return "bios";
+        case Region::Ewram:
+            return "ewram";
+        case Region::Iwram:
+            return "iwram";
+        case Region::Io:
+            return "io";
+        case Region::Pram:
+            return "pram";
+        case Region::Vram:
+            return "vram";
+        case Region::Oam:
+            return "oam";
+        case Region::Rom:
+            return "rom";
+        case Region::Sram:
+            return "sram";
+        case Region::Unmapped:
+            return "unmapped";
+    }
+
+    return "unknown";
+}
+
+static const char*
+direction_name(int direction) {
+    return direction == static_cast<int>(AccessStats::Direction::Read)
+             ? "read"
+             : "write";
+}
+
+static const char*
+access_name(int sequential) {
+    return sequential ? "sequential" : "non_sequential";
+}
+
+void
+AccessStats::enable_heatmap(bool enable) {
+    heatmap_enabled = enable;
+
+    for (int r = 0; r < N_REGIONS; r++) {
+        for (auto& dir : pages[r]) {
+            dir.assign(enable ? REGION_SPAN[r] / PAGE_SIZE +
+                                  (REGION_SPAN[r] % PAGE_SIZE != 0)
+                              : 0,
+                       0);
+        }
+    }
+}
+
+void
+AccessStats::reset() {
+    counters = {};
+
+    for (auto& region : pages) {
+        for (auto& dir : region) {
+            std::fill(dir.begin(), dir.end(), 0);
+        }
+    }
+}
+
+void
+AccessStats::record_page(Region region, Direction direction, uint32_t address) {
+    uint32_t span = REGION_SPAN[static_cast<int>(region)];
+
+    if (span == 0) {
+        return;
+    }
+
+    auto& dir = pages[static_cast<int>(region)][static_cast<int>(direction)];
+    dir[(address & (span - 1)) / PAGE_SIZE]++;
+}
+
+std::string
+AccessStats::to_csv() const {
+    std::string csv = "region,direction,width,access,count,cycles\n";
+
+    for (int r = 0; r < N_REGIONS; r++) {
+        for (int d = 0; d < N_DIRECTIONS; d++) {
+            for (int w = 0; w < N_WIDTHS; w++) {
+                for (int a = 0; a < N_ACCESSES; a++) {
+                    const Counter& counter = counters[r][d][w][a];
+
+                    if (counter.count == 0) {
+                        continue;
+                    }
+
+                    csv += std::format("{},{},{},{},{},{}\n",
+                                       region_name(static_cast<Region>(r)),
+                                       direction_name(d),
+                                       WIDTHS[w],
+                                       access_name(a),
+                                       counter.count,
+                                       counter.cycles);
+                }
+            }
+        }
+    }
+
+    return csv;
+}
+
+std::string
+AccessStats::heatmap_to_csv() const {
+    std::string csv = "region,direction,page,count\n";
+
+    for (int r = 0; r < N_REGIONS; r++) {
+        for (int d = 0; d < N_DIRECTIONS; d++) {
+            const auto& dir = pages[r][d];
+
+            for (size_t p = 0; p < dir.size(); p++) {
+                if (dir[p] == 0) {
+                    continue;
+                }
+
+                csv += std::format("{},{},0x{:08x},{}\n",
+                                   region_name(static_cast<Region>(r)),
+                                   direction_name(d),
+                                   p * PAGE_SIZE,
+                                   dir[p]);
+            }
+        }
+    }
+
+    return csv;
+}
+
+std::string
+AccessStats::to_json() const {
+    std::string json = "{\n  \"page_size\": " + std::to_string(PAGE_SIZE) +
+                       ",\n  \"regions\": {";
+    bool first_region = true;
+
+    for (int r = 0; r < N_REGIONS; r++) {
+        json += std::format("{}\n    \"{}\": {{",
+                            first_region ? "" : ",",
+                            region_name(static_cast<Region>(r)));
+        first_region = false;
+
+        for (int d = 0; d < N_DIRECTIONS; d++) {
+            json += std::format("{}\n      \"{}\": {{ \"counters\": [",
+                                d == 0 ? "" : ",",
+                                direction_name(d));
+            bool first = true;
+
+            for (int w = 0; w < N_WIDTHS; w++) {
+                for (int a = 0; a < N_ACCESSES; a++) {
+                    const Counter& counter = counters[r][d][w][a];
+
+                    json += std::format(
+                      "{}\n        {{ \"width\": {}, \"access\": \"{}\", "
+                      "\"count\": {}, \"cycles\": {} }}",
+                      first ? "" : ",",
+                      WIDTHS[w],
+                      access_name(a),
+                      counter.count,
+                      counter.cycles);
+                    first = false;
+                }
+            }
+
+            json += "\n      ]";
+
+            if (heatmap_enabled) {
+                json += ", \"heatmap\": [";
+                const auto& dir = pages[r][d];
+
+                for (size_t p = 0; p < dir.size(); p++) {
+                    json += std::format("{}{}", p == 0 ? "" : ", ", dir[p]);
+                }
+
+                json += "]";
+            }
+
+            json += " }";
+        }
+
+        json += "\n    }";
+    }
+
+    json += "\n  }\n}\n";
+    return json;
+}
+
+void
+AccessStats::dump(const std::string& path) const {
+    bool json = path.ends_with(".json");
+    std::ofstream file(path);
+
+    if (!file.is_open()) {
+        glogger.error("could not open {} for access statistics", path);
+        return;
+    }
+
+    file << (json ? to_json() : to_csv());
+
+    if (json || !heatmap_enabled) {
+        return;
+    }
+
+    std::string stem =
+      path.ends_with(".csv") ? path.substr(0, path.size() - 4) : path;
+    std::ofstream heatmap_file(stem + "-heatmap.csv");
+
+    if (!heatmap_file.is_open()) {
+        glogger.error("could not open {}-heatmap.csv for access heatmap", stem);
+        return;
+    }
+
+    heatmap_file << heatmap_to_csv();
+}
+}
@@ -0,0 +1,223 @@
+#include "arena.hh"
+#include "util/log.hh"
+#include <cerrno>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+namespace matar {
+
+MemoryArena::MemoryArena() {
+    void* ptr = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    ptr = mmap(nullptr,
+               SIZE,
+               PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+               -1,
+               0);
+
+    if (ptr != MAP_FAILED) {
+        base     = static_cast<uint8_t*>(ptr);
+        backing_ = Backing::HugeTlb;
+        glogger.info("Memory arena backed by a hugetlbfs page");
+        return;
+    }
+#endif
+
+    // map twice the size so that a 2 MiB aligned block can be carved out,
+    // transparent huge pages are only used for aligned ranges
+    ptr = mmap(nullptr,
+               2 * SIZE,
+               PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS,
+               -1,
+               0);
+
+    if (ptr == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+
+    auto start   = reinterpret_cast<uintptr_t>(ptr);
+    auto aligned = (start + SIZE - 1) & ~(SIZE - 1);
+
+    if (aligned > start) {
+        munmap(ptr, aligned - start);
+    }
+
+    if (start + 2 * SIZE > aligned + SIZE) {
+        munmap(reinterpret_cast<void*>(aligned + SIZE),
+               start + 2 * SIZE - (aligned + SIZE));
+    }
+
+    base     = reinterpret_cast<uint8_t*>(aligned);
+    backing_ = Backing::Regular;
+
+#ifdef MADV_HUGEPAGE
+    if (madvise(base, SIZE, MADV_HUGEPAGE) == 0) {
+        backing_ = Backing::Transparent;
+        glogger.info("Memory arena backed by a transparent huge page");
+        return;
+    }
+#endif
+
+    glogger.warn("Huge pages are not available, memory arena uses regular "
+                 "pages");
+}
+
+MemoryArena::MemoryArena(std::size_t size, int file, bool shared)
+  : size(size)
+  , backing_(Backing::Forkable)
+  , file(file)
+  , shared(shared) {
+    void* ptr = mmap(nullptr,
+                     size,
+                     PROT_READ | PROT_WRITE,
+                     shared ? MAP_SHARED : MAP_PRIVATE,
+                     file,
+                     0);
+
+    if (ptr == MAP_FAILED) {
+        close(file);
+        throw std::bad_alloc();
+    }
+
+    base = static_cast<uint8_t*>(ptr);
+}
+
+MemoryArena::~MemoryArena() {
+    munmap(base, size);
+
+    if (file >= 0) {
+        close(file);
+    }
+}
+
+static int
+make_file(std::size_t size) {
+    int file = memfd_create("matar-arena", MFD_CLOEXEC);
+
+    if (file < 0) {
+        throw std::system_error(
+          errno, std::generic_category(), "Could not make a memory file");
+    }
+
+    if (ftruncate(file, size) != 0) {
+        int error = errno;
+        close(file);
+        throw std::system_error(
+          error, std::generic_category(), "Could not size a memory file");
+    }
+
+    return file;
+}
+
+std::unique_ptr<MemoryArena>
+MemoryArena::forkable(std::size_t size) {
+    const std::size_t page = sysconf(_SC_PAGESIZE);
+    size                   = (size + page - 1) & ~(page - 1);
+
+    /* writes go straight to the file until the first fork, so that one does
+     * not have to copy anything */
+    return std::unique_ptr<MemoryArena>(
+      new MemoryArena(size, make_file(size), true));
+}
+
+std::unique_ptr<MemoryArena>
+MemoryArena::fork() {
+    if (backing_ != Backing::Forkable) {
+        throw std::logic_error("Only forkable arenas can be forked");
+    }
+
+    auto remap = [this](int from) {
+        if (mmap(base,
+                 size,
+                 PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_FIXED,
+                 from,
+                 0) == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+    };
+
+    if (shared) {
+        /* the file holds everything, but it has to stay as it is from here
+         * on for the fork */
+        remap(file);
+        shared = false;
+    } else if (has_own_pages()) {
+        /* the file no longer holds what the arena does, so it is left to the
+         * forks made before and the arena moves to a copy of itself */
+        int copy = make_file(size);
+
+        for (std::size_t done = 0; done < size;) {
+            ssize_t written = pwrite(copy, base + done, size - done, done);
+
+            if (written <= 0) {
+                int error = errno;
+                close(copy);
+                throw std::system_error(
+                  error, std::generic_category(), "Could not fork an arena");
+            }
+
+            done += written;
+        }
+
+        remap(copy);
+        close(file);
+        file = copy;
+    }
+
+    int file = fcntl(this->file, F_DUPFD_CLOEXEC, 0);
+
+    if (file < 0) {
+        throw std::system_error(
+          errno, std::generic_category(), "Could not fork an arena");
+    }
+
+    return std::unique_ptr<MemoryArena>(new MemoryArena(size, file, false));
+}
+
+bool
+MemoryArena::has_own_pages() const {
+    const std::size_t page  = sysconf(_SC_PAGESIZE);
+    const std::size_t pages = size / page;
+
+    std::vector<uint64_t> entries(pages);
+    const std::size_t bytes = pages * sizeof(uint64_t);
+
+    int pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+
+    /* without a way to tell, every page may have been written */
+    if (pagemap < 0) {
+        return true;
+    }
+
+    const off_t offset =
+      reinterpret_cast<uintptr_t>(base) / page * sizeof(uint64_t);
+    const ssize_t read = pread(pagemap, entries.data(), bytes, offset);
+    close(pagemap);
+
+    if (read != static_cast<ssize_t>(bytes)) {
+        return true;
+    }
+
+    /* a page written to becomes the arena's own, one that is in memory
+     * without being a page of the file, or that was swapped out */
+    for (uint64_t entry : entries) {
+        const bool present   = entry >> 63 & 1;
+        const bool swapped   = entry >> 62 & 1;
+        const bool file_page = entry >> 61 & 1;
+
+        if (swapped || (present && !file_page)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+}
@@ -0,0 +1,93 @@
+#include "boot.hh"
+#include "bus.hh"
+#include "cpu/cpu.hh"
+#include "savestate.hh"
+#include "util/log.hh"
+#include <cstdlib>
+#include <format>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace matar {
+BootMode
+parse_boot_mode(std::string_view name) {
+    if (name == "bios")
+        return BootMode::Bios;
+    if (name == "direct")
+        return BootMode::Direct;
+    if (name == "snapshot")
+        return BootMode::Snapshot;
+
+    throw std::invalid_argument("Unknown boot mode " + std::string(name));
+}
+
+std::filesystem::path
+default_boot_cache() {
+    if (const char* cache = std::getenv("XDG_CACHE_HOME");
+        cache != nullptr && *cache != '\0') {
+        return std::filesystem::path(cache) / "matar";
+    }
+
+    if (const char* home = std::getenv("HOME");
+        home != nullptr && *home != '\0') {
+        return std::filesystem::path(home) / ".cache" / "matar";
+    }
+
+    /* still one of the user's own, the temp dir is shared */
+    return std::filesystem::temp_directory_path() /
+           std::format("matar-{}", getuid());
+}
+
+void
+boot(Bus& bus,
+     Cpu& cpu,
+     BootMode mode,
+     const std::filesystem::path& cache) {
+    switch (mode) {
+        case BootMode::Bios:
+            return;
+        case BootMode::Direct:
+            bus.skip_bios();
+            cpu.skip_bios();
+            return;
+        case BootMode::Snapshot:
+            break;
+    }
+
+    /* The BIOS goes by the ROM's header. Builds that save states another
+     * way get snapshots of their own, rather than writing over each other's
+     * whenever they take turns with a cache. */
+    const auto path = cache / std::format("{:016x}-{:016x}-v{}-{}.sav",
+                                          bus.rom_hash(),
+                                          bus.bios_hash(),
+                                          SAVESTATE_VERSION,
+                                          savestate_scheduler());
+
+    if (std::filesystem::exists(path)) {
+        try {
+            load_state_file(bus, cpu, path.string());
+            return;
+        } catch (const std::invalid_argument& e) {
+            /* cut short or corrupt, it is written over */
+            glogger.warn(
+              "Boot snapshot {} not loaded: {}", path.string(), e.what());
+        }
+    }
+
+    bus.run_bios();
+
+    /* written under a name of its own first, so that runs of the same ROM
+     * booting at the same time never load half of it */
+    const auto thread =
+      std::hash<std::thread::id>()(std::this_thread::get_id());
+    auto partial = path;
+    partial += std::format(".{}-{}", getpid(), thread);
+
+    std::filesystem::create_directories(cache);
+    save_state_file(bus, cpu, partial.string());
+    std::filesystem::rename(partial, path);
+}
+}
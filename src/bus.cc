@@ -3,8 +3,11 @@
 #include "io/io.hh"
 #include "io/system/registers.hh"
 #include "util/crypto.hh"
+#include "util/hash.hh"
 #include "util/log.hh"
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 
 namespace matar {
 
@@ -57,12 +60,38 @@ make_cycle_map() {
     return map;
 }
 
-Bus::Bus(std::array<uint8_t, BIOS_SIZE>&& bios, std::vector<uint8_t>&& rom)
+// the ROM of a forkable bus goes to an arena of its own, to be shared with
+// forks as well
+static Memory<>
+rom_memory(std::vector<uint8_t>&& rom,
+           MemoryArena* arena,
+           std::unique_ptr<MemoryArena>& rom_arena) {
+    if (arena == nullptr ||
+        arena->backing() != MemoryArena::Backing::Forkable) {
+        return Memory<>(std::move(rom));
+    }
+
+    rom_arena = MemoryArena::forkable(rom.size());
+
+    auto view = rom_arena->allocate(rom.size());
+    std::ranges::copy(rom, view.begin());
+    return Memory<>(view);
+}
+
+Bus::Bus(std::array<uint8_t, BIOS_SIZE>&& bios,
+         std::vector<uint8_t>&& rom,
+         std::unique_ptr<MemoryArena> arena)
   : cpu(nullptr)
-  , io(*this, scheduler)
-  , bios(std::move(bios))
-  , rom(std::move(rom)) {
-    std::string bios_hash = crypto::sha256(this->bios.data());
+  , arena(std::move(arena))
+  , io(*this, scheduler, this->arena.get())
+  , bios(arena_memory<BIOS_SIZE>(this->arena.get()))
+  , board_wram(arena_memory<BOARD_WRAM_SIZE>(this->arena.get()))
+  , chip_wram(arena_memory<CHIP_WRAM_SIZE>(this->arena.get()))
+  , sram(arena_memory<SRAM_SIZE>(this->arena.get()))
+  , rom(rom_memory(std::move(rom), this->arena.get(), rom_arena)) {
+    std::ranges::copy(bios, this->bios.data().begin());
+
+    std::string bios_hash = crypto::sha256(bios);
     static constexpr std::string_view expected_hash =
       "fd2547724b505f487e6dcb29ec2ecff3af35a841a77ab2e85fd87350abd36570";
 
@@ -76,12 +105,42 @@ Bus::Bus(std::array<uint8_t, BIOS_SIZE>&& bios, std::vector<uint8_t>&& rom)
 
     parse_header();
 
-    cycle_map = make_cycle_map();
+    cycle_map  = make_cycle_map();
+    rom_digest  = hash::xxh64(this->rom.data());
+    bios_digest = hash::xxh64(bios);
 
     glogger.info("Memory successfully initialised");
     glogger.info("Cartridge Title: {}", header.title);
 };
 
+/* the arenas are forks of the other's, memory is allocated from them in the
+ * same order to get back the same contents */
+Bus::Bus(const Bus& other,
+         std::unique_ptr<MemoryArena> arena,
+         std::unique_ptr<MemoryArena> rom_arena)
+  : cpu(nullptr)
+  , arena(std::move(arena))
+  , rom_arena(std::move(rom_arena))
+  , io(*this, scheduler, this->arena.get())
+  , bios(arena_memory<BIOS_SIZE>(this->arena.get()))
+  , board_wram(arena_memory<BOARD_WRAM_SIZE>(this->arena.get()))
+  , chip_wram(arena_memory<CHIP_WRAM_SIZE>(this->arena.get()))
+  , sram(arena_memory<SRAM_SIZE>(this->arena.get()))
+  , rom(this->rom_arena->allocate(other.rom.size()))
+  , rom_digest(other.rom_digest)
+  , bios_digest(other.bios_digest)
+  , header(other.header) {}
+
+std::unique_ptr<Bus>
+Bus::sharing_memory_of(Bus& other) {
+    if (other.rom_arena == nullptr) {
+        throw std::logic_error("Only buses with a forkable arena can fork");
+    }
+
+    return std::unique_ptr<Bus>(
+      new Bus(other, other.arena->fork(), other.rom_arena->fork()));
+}
+
 void
 Bus::update_cycle_map(WaitstateControl waitcnt) {
     static constexpr std::array<int, 4> WAITSTATE_X_FST = { 4, 3, 2, 8 };
@@ -122,46 +181,180 @@ Bus::update_cycle_map(WaitstateControl waitcnt) {
     rom2_1   = rom2;
 }
 
+template<typename T>
+void
+Bus::access_cycles(uint32_t address,
+                   CpuAccess access,
+                   [[maybe_unused]] AccessStats::Direction direction) {
+    auto cc = cycle_map[(address >> 24) & 0xF];
+    uint8_t cycles;
+
+    if constexpr (sizeof(T) == 4) {
+        cycles = access == CpuAccess::Sequential ? cc.s32 : cc.n32;
+    } else {
+        cycles = access == CpuAccess::Sequential ? cc.s16 : cc.n16;
+    }
+
+    scheduler.add_cycles(cycles);
+
+#ifdef ACCESS_STATS
+    stats.record(address,
+                 direction,
+                 sizeof(T),
+                 access == CpuAccess::Sequential,
+                 cycles);
+#endif
+}
+
 void
 Bus::step() {
     uint64_t current = get_cycles();
 
     while (!scheduler.empty() && scheduler.top().cycles <= current) {
         auto event = scheduler.top();
-        io.scheduler_event(event.type, event.cycles);
         scheduler.pop();
+        io.scheduler_event(event.type, event.cycles);
     }
 }
 
 void
-Bus::run(uint64_t cyc) {
-    while (get_cycles() < cyc) {
-        if (!scheduler.empty()) {
-            // glogger.info("cycling for {} cycles",
-            // scheduler.top().cycles - get_cycles());
-
-            while (get_cycles() < scheduler.top().cycles) {
-                if (io.any_is_interrupt_pending()) {
-                    cpu->irq();
-                }
+Bus::save(StateWriter& state) const {
+    state.put(cycle_map);
+    state.put(last_bios_word);
 
-                cpu->step();
-            }
+    state.put_memory(board_wram.data());
+    state.put_memory(chip_wram.data());
+    state.put_memory(sram.data());
 
-            while (!scheduler.empty() &&
-                   scheduler.top().cycles <= get_cycles()) {
-                auto event = scheduler.top();
-                io.scheduler_event(event.type, event.cycles);
-                scheduler.pop();
-            }
-        } else {
-            if (io.any_is_interrupt_pending()) {
-                cpu->irq();
+    scheduler.save(state);
+    io.save(state);
+}
+
+void
+Bus::load(StateReader& state) {
+    state.get(cycle_map);
+    state.get(last_bios_word);
+
+    state.get_memory(board_wram.data());
+    state.get_memory(chip_wram.data());
+    state.get_memory(sram.data());
+
+    /* before the devices, which may schedule events as they load */
+    scheduler.load(state);
+    io.load(state);
+}
+
+RunStats
+Bus::run(uint64_t cycles) {
+    const uint64_t end = get_cycles() + cycles;
+    return run_until([this, end]() { return get_cycles() >= end; });
+}
+
+RunStats
+Bus::run_until(const std::function<bool()>& done) {
+    RunStats stats;
+    auto start     = std::chrono::steady_clock::now();
+    uint64_t begin = get_cycles();
+
+    auto step_cpu = [this, &stats]() {
+        if (io.any_is_interrupt_pending()) {
+            cpu->irq();
+        }
+
+        cpu->step();
+        stats.instructions++;
+    };
+
+    while (!done()) {
+        if (scheduler.empty()) {
+            step_cpu();
+            continue;
+        }
+
+        while (get_cycles() < scheduler.top().cycles) {
+            step_cpu();
+        }
+
+        // the event is popped before it is handled so that anything it
+        // schedules stays in the queue
+        while (!scheduler.empty() && scheduler.top().cycles <= get_cycles()) {
+            auto event = scheduler.top();
+            scheduler.pop();
+            io.scheduler_event(event.type, event.cycles);
+            stats.events++;
+
+            if (done()) {
+                break;
             }
+        }
+    }
+
+    stats.cycles    = get_cycles() - begin;
+    stats.host_time = std::chrono::steady_clock::now() - start;
+    return stats;
+}
+
+RunStats
+Bus::run_frame() {
+    uint64_t frame = io.frame_count();
+
+    return run_until([this, frame]() { return io.frame_count() != frame; });
+}
+
+RunStats
+Bus::run_bios() {
+    // the intro takes about four seconds
+    static constexpr uint64_t LIMIT = 16 << 24;
 
-            cpu->step();
+    RunStats stats;
+    auto start     = std::chrono::steady_clock::now();
+    uint64_t begin = get_cycles();
+
+    /* checked after every instruction rather than every event, to stop
+     * right at the jump, which leaves the program counter two instructions
+     * into the cartridge */
+    while (cpu->state() != State::Arm ||
+           cpu->program_counter() != ROM_0_START + 8) {
+        if (get_cycles() - begin >= LIMIT) {
+            throw std::runtime_error("BIOS did not jump to the cartridge");
+        }
+
+        while (!scheduler.empty() && scheduler.top().cycles <= get_cycles()) {
+            auto event = scheduler.top();
+            scheduler.pop();
+            io.scheduler_event(event.type, event.cycles);
+            stats.events++;
+        }
+
+        if (io.any_is_interrupt_pending()) {
+            cpu->irq();
         }
+
+        cpu->step();
+        stats.instructions++;
     }
+
+    stats.cycles    = get_cycles() - begin;
+    stats.host_time = std::chrono::steady_clock::now() - start;
+    return stats;
+}
+
+void
+Bus::skip_bios() {
+    static constexpr uint32_t SOUNDBIAS = 0x4000088;
+    static constexpr uint32_t POSTFLG   = 0x4000300;
+
+    io.write_byte(POSTFLG, 1);
+    io.write_halfword(SOUNDBIAS, 0x200);
+
+    /* identity transforms for both affine backgrounds, PA and PD */
+    for (uint32_t address : { 0x4000020, 0x4000030 }) {
+        io.write_halfword(address, 0x100);
+        io.write_halfword(address + 6, 0x100);
+    }
+
+    /* the BIOS returns from the SWI it was last in */
+    last_bios_word = 0xE129F000;
 }
 
 template<typename T>
@@ -173,8 +366,8 @@ Bus::read_illegal(uint32_t address) const {
     uint32_t pc;
 
     if (cpu == nullptr) {
-        glogger.error("cpu is null, make sure to assign it to the Bus");
-        std::abort();
+        throw std::logic_error(
+          "cpu is null, make sure to assign it to the Bus");
     }
 
     decoded    = cpu->opcode0() & 0xFFFF;
@@ -211,8 +404,7 @@ Bus::read_illegal(uint32_t address) const {
 
 uint8_t
 Bus::read_byte(uint32_t address, CpuAccess access) {
-    auto cc = cycle_map[(address >> 24) & 0xF];
-    scheduler.add_cycles(access == CpuAccess::Sequential ? cc.s16 : cc.n16);
+    access_cycles<uint8_t>(address, access, AccessStats::Direction::Read);
 
     switch ((address >> 24) & 0xF) {
         case (BIOS_START >> 24) & 0xF: {
@@ -291,8 +483,7 @@ Bus::read_byte(uint32_t address, CpuAccess access) {
 
 uint16_t
 Bus::read_halfword(uint32_t address, CpuAccess access) {
-    auto cc = cycle_map[(address >> 24) & 0xF];
-    scheduler.add_cycles(access == CpuAccess::Sequential ? cc.s16 : cc.n16);
+    access_cycles<uint16_t>(address, access, AccessStats::Direction::Read);
 
     switch ((address >> 24) & 0xF) {
         case (BIOS_START >> 24) & 0xF: {
@@ -371,8 +562,7 @@ Bus::read_halfword(uint32_t address, CpuAccess access) {
 
 uint32_t
 Bus::read_word(uint32_t address, CpuAccess access) {
-    auto cc = cycle_map[(address >> 24) & 0xF];
-    scheduler.add_cycles(access == CpuAccess::Sequential ? cc.s32 : cc.n32);
+    access_cycles<uint32_t>(address, access, AccessStats::Direction::Read);
 
     switch ((address >> 24) & 0xF) {
         case (BIOS_START >> 24) & 0xF: {
@@ -451,8 +641,7 @@ Bus::read_word(uint32_t address, CpuAccess access) {
 
 void
 Bus::write_byte(uint32_t address, uint8_t byte, CpuAccess access) {
-    auto cc = cycle_map[(address >> 24) & 0xF];
-    scheduler.add_cycles(access == CpuAccess::Sequential ? cc.s16 : cc.n16);
+    access_cycles<uint8_t>(address, access, AccessStats::Direction::Write);
 
     switch ((address >> 24) & 0xF) {
         case (BOARD_WRAM_START >> 24) & 0xF: {
@@ -489,16 +678,25 @@ Bus::write_byte(uint32_t address, uint8_t byte, CpuAccess access) {
                 break;
             }
 
-            io.vram().write_halfword(offset & ~1,
-                                     static_cast<uint16_t>(byte) * 0x101);
+            uint16_t halfword = static_cast<uint16_t>(byte) * 0x101;
+
+            /* only actual changes to what is drawn count as writes */
+            if (io.vram().read_halfword(offset & ~1) != halfword) {
+                io.vram().write_halfword(offset & ~1, halfword);
+                io.vram_written(offset);
+            }
             break;
         }
 
         case (PRAM_START >> 24) & 0xF: {
             uint32_t offset = address & (io.pram().size() - 1);
 
-            io.pram().write_halfword(offset & ~1,
-                                     static_cast<uint16_t>(byte) * 0x101);
+            uint16_t halfword = static_cast<uint16_t>(byte) * 0x101;
+
+            if (io.pram().read_halfword(offset & ~1) != halfword) {
+                io.pram().write_halfword(offset & ~1, halfword);
+                io.pram_written(offset);
+            }
             break;
         }
 
@@ -509,8 +707,7 @@ Bus::write_byte(uint32_t address, uint8_t byte, CpuAccess access) {
 
 void
 Bus::write_halfword(uint32_t address, uint16_t halfword, CpuAccess access) {
-    auto cc = cycle_map[(address >> 24) & 0xF];
-    scheduler.add_cycles(access == CpuAccess::Sequential ? cc.s16 : cc.n16);
+    access_cycles<uint16_t>(address, access, AccessStats::Direction::Write);
 
     switch ((address >> 24) & 0xF) {
         case (BOARD_WRAM_START >> 24) & 0xF: {
@@ -539,7 +736,11 @@ Bus::write_halfword(uint32_t address, uint16_t halfword, CpuAccess access) {
         case (PRAM_START >> 24) & 0xF: {
             uint32_t offset = address & (io.pram().size() - 1);
 
-            io.pram().write_halfword(offset, halfword);
+            /* only actual changes to what is drawn count as writes */
+            if (io.pram().read_halfword(offset) != halfword) {
+                io.pram().write_halfword(offset, halfword);
+                io.pram_written(offset);
+            }
             break;
         }
 
@@ -550,14 +751,20 @@ Bus::write_halfword(uint32_t address, uint16_t halfword, CpuAccess access) {
                 offset -= 32 * 1024;
             }
 
-            io.vram().write_halfword(offset, halfword);
+            if (io.vram().read_halfword(offset) != halfword) {
+                io.vram().write_halfword(offset, halfword);
+                io.vram_written(offset);
+            }
             break;
         }
 
         case (OAM_START >> 24) & 0xF: {
             uint32_t offset = address & (io.oam().size() - 1);
 
-            io.oam().write_halfword(offset, halfword);
+            if (io.oam().read_halfword(offset) != halfword) {
+                io.oam().write_halfword(offset, halfword);
+                io.oam_written();
+            }
             break;
         }
 
@@ -584,8 +791,7 @@ Bus::write_halfword(uint32_t address, uint16_t halfword, CpuAccess access) {
 
 void
 Bus::write_word(uint32_t address, uint32_t word, CpuAccess access) {
-    auto cc = cycle_map[(address >> 24) & 0xF];
-    scheduler.add_cycles(access == CpuAccess::Sequential ? cc.s32 : cc.n32);
+    access_cycles<uint32_t>(address, access, AccessStats::Direction::Write);
 
     switch ((address >> 24) & 0xF) {
         case (BOARD_WRAM_START >> 24) & 0xF: {
@@ -614,7 +820,11 @@ Bus::write_word(uint32_t address, uint32_t word, CpuAccess access) {
         case (PRAM_START >> 24) & 0xF: {
             uint32_t offset = address & (io.pram().size() - 1);
 
-            io.pram().write_word(offset, word);
+            /* only actual changes to what is drawn count as writes */
+            if (io.pram().read_word(offset) != word) {
+                io.pram().write_word(offset, word);
+                io.pram_written(offset);
+            }
             break;
         }
 
@@ -625,14 +835,20 @@ Bus::write_word(uint32_t address, uint32_t word, CpuAccess access) {
                 offset -= 32 * 1024;
             }
 
-            io.vram().write_word(offset, word);
+            if (io.vram().read_word(offset) != word) {
+                io.vram().write_word(offset, word);
+                io.vram_written(offset);
+            }
             break;
         }
 
         case (OAM_START >> 24) & 0xF: {
             uint32_t offset = address & (io.oam().size() - 1);
 
-            io.oam().write_word(offset, word);
+            if (io.oam().read_word(offset) != word) {
+                io.oam().write_word(offset, word);
+                io.oam_written();
+            }
             break;
         }
 
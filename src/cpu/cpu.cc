@@ -120,6 +120,9 @@ Cpu::step() {
         opcodes[1] = bus.read_word(pc, next_access);
 
 #ifdef DISASSEMBLER
+        /* disassembling costs far more than anything else in a step, so it
+         * is only done for a message that goes somewhere */
+        if (glogger.enabled(LogLevel::Info))
             glogger.info("0x{:08X} : {}",
                          pc - 2 * arm::INSTRUCTION_SIZE,
                          instruction.disassemble());
@@ -133,6 +136,7 @@ Cpu::step() {
         opcodes[1] = bus.read_halfword(pc, next_access);
 
 #ifdef DISASSEMBLER
+        if (glogger.enabled(LogLevel::Info))
             glogger.info("0x{:08X} : {}",
                          pc - 2 * thumb::INSTRUCTION_SIZE,
                          instruction.disassemble());
@@ -192,4 +196,47 @@ Cpu::irq() {
     pc = IRQ_VECTOR;
     flush_pipeline();
 }
+
+void
+Cpu::skip_bios() {
+    /* the stacks the BIOS sets up, System mode is the one it leaves in */
+    chg_mode(Mode::Irq);
+    sp = 0x3007FA0;
+    chg_mode(Mode::Supervisor);
+    sp = 0x3007FE0;
+    chg_mode(Mode::System);
+    sp = 0x3007F00;
+
+    std::fill(gpr.begin(), gpr.begin() + SP_INDEX, 0);
+    lr = 0;
+
+    cpsr.set_irq_disabled(false);
+    cpsr.set_fiq_disabled(false);
+    cpsr.set_state(State::Arm);
+
+    pc = ROM_START;
+    flush_pipeline();
+}
+
+void
+Cpu::save(StateWriter& state) const {
+    state.put(gpr);
+    state.put(cpsr);
+    state.put(spsr);
+    state.put(gpr_banked);
+    state.put(spsr_banked);
+    state.put(next_access);
+    state.put(opcodes);
+}
+
+void
+Cpu::load(StateReader& state) {
+    state.get(gpr);
+    state.get(cpsr);
+    state.get(spsr);
+    state.get(gpr_banked);
+    state.get(spsr_banked);
+    state.get(next_access);
+    state.get(opcodes);
+}
 }
@@ -0,0 +1,26 @@
+#include "fork.hh"
+#include "util/state.hh"
+#include <vector>
+
+namespace matar {
+Instance
+fork(Bus& bus, Cpu& cpu) {
+    std::vector<uint8_t> state;
+    StateWriter writer(state, false);
+
+    cpu.save(writer);
+    bus.save(writer);
+
+    Instance child;
+    child.bus = Bus::sharing_memory_of(bus);
+    child.cpu = std::make_unique<Cpu>(*child.bus);
+
+    /* after making the CPU, whose first fetches count cycles */
+    StateReader reader(state, false);
+
+    child.cpu->load(reader);
+    child.bus->load(reader);
+
+    return child;
+}
+}
@@ -0,0 +1,333 @@
+#include "io/display/affine_samplers.hh"
+#include <algorithm>
+#include <array>
+#include <bit>
+
+#ifdef AFFINE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace matar {
+namespace display {
+
+static constexpr uint32_t TILE_SIZE            = 8;
+static constexpr uint32_t TILE_SIZE_8BIT_DEPTH = 64;
+static constexpr uint32_t TILE_SIZE_4BIT_DEPTH = 32;
+
+void
+sample_affine_background_scalar(const AffineBackground& bg,
+                                std::span<uint16_t, LCD_WIDTH> line) {
+    const int32_t n_tiles = bg.size / TILE_SIZE;
+
+    for (int x = 0; x < LCD_WIDTH; x++) {
+        Vec2<int32_t> texel = {
+            (bg.origin.x + x * bg.step.x) >> 8,
+            (bg.origin.y + x * bg.step.y) >> 8,
+        };
+
+        /* area overflow */
+        if (texel.x < 0 || texel.x >= bg.size || texel.y < 0 ||
+            texel.y >= bg.size) {
+            if (bg.wraparound) {
+                texel.x &= bg.size - 1;
+                texel.y &= bg.size - 1;
+            } else {
+                line[x] = TRANSPARENT_RGB555;
+                continue;
+            }
+        }
+
+        uint32_t map_address =
+          bg.map_base + texel.x / TILE_SIZE + texel.y / TILE_SIZE * n_tiles;
+
+        /* only supports 8 bit depth */
+        uint32_t tile_address =
+          bg.tile_base + bg.vram[map_address] * TILE_SIZE_8BIT_DEPTH;
+
+        uint8_t index = bg.vram[tile_address + texel.y % TILE_SIZE * TILE_SIZE +
+                                texel.x % TILE_SIZE];
+
+        line[x] = index == 0 ? TRANSPARENT_RGB555 : bg.palette[index];
+    }
+}
+
+void
+sample_affine_object_scalar(const AffineObject& obj,
+                            std::span<uint16_t> pixels) {
+    const uint32_t tile_size =
+      obj.colors256 ? TILE_SIZE_8BIT_DEPTH : TILE_SIZE_4BIT_DEPTH;
+
+    for (size_t i = 0; i < pixels.size(); i++) {
+        Vec2<int32_t> texel = {
+            ((obj.origin.x + static_cast<int32_t>(i) * obj.step.x) >> 8) +
+              obj.size.x / 2,
+            ((obj.origin.y + static_cast<int32_t>(i) * obj.step.y) >> 8) +
+              obj.size.y / 2,
+        };
+
+        pixels[i] = TRANSPARENT_RGB555;
+
+        if (texel.x < 0 || texel.x >= obj.size.x || texel.y < 0 ||
+            texel.y >= obj.size.y) {
+            continue;
+        }
+
+        uint32_t address =
+          obj.tile_base + tile_size * (texel.x / TILE_SIZE +
+                                       texel.y / TILE_SIZE * obj.tiles_per_row);
+        uint32_t pixel = texel.y % TILE_SIZE * TILE_SIZE + texel.x % TILE_SIZE;
+
+        address += obj.colors256 ? pixel : pixel / 2;
+
+        /* tiles past the end of VRAM are transparent */
+        if (address >= obj.vram_size) {
+            continue;
+        }
+
+        uint8_t index = obj.vram[address];
+
+        if (!obj.colors256) {
+            index = texel.x & 1 ? index >> 4 : index & 0xF;
+        }
+
+        if (index != 0) {
+            pixels[i] = obj.palette[obj.palette_offset + index];
+        }
+    }
+}
+
+#ifdef AFFINE_AVX2
+/* gathers read whole words, so they are made at aligned addresses to never
+ * read past the end of the memory they gather from */
+[[gnu::target("avx2")]] static inline __m256i
+gather_u8(const uint8_t* base, __m256i address, __m256i mask) {
+    const __m256i three = _mm256_set1_epi32(3);
+
+    __m256i words = _mm256_mask_i32gather_epi32(
+      _mm256_setzero_si256(),
+      reinterpret_cast<const int*>(base),
+      _mm256_andnot_si256(three, address),
+      mask,
+      1);
+    __m256i shift = _mm256_slli_epi32(_mm256_and_si256(address, three), 3);
+
+    return _mm256_and_si256(_mm256_srlv_epi32(words, shift),
+                            _mm256_set1_epi32(0xFF));
+}
+
+[[gnu::target("avx2")]] static inline __m256i
+gather_u16(const uint16_t* base, __m256i index, __m256i mask) {
+    const __m256i one = _mm256_set1_epi32(1);
+
+    __m256i words = _mm256_mask_i32gather_epi32(
+      _mm256_setzero_si256(),
+      reinterpret_cast<const int*>(base),
+      _mm256_andnot_si256(one, index),
+      mask,
+      2);
+    __m256i shift = _mm256_slli_epi32(_mm256_and_si256(index, one), 4);
+
+    return _mm256_and_si256(_mm256_srlv_epi32(words, shift),
+                            _mm256_set1_epi32(0xFFFF));
+}
+
+// lanes with 0 <= value < limit
+[[gnu::target("avx2")]] static inline __m256i
+in_range(__m256i value, __m256i limit) {
+    return _mm256_andnot_si256(
+      _mm256_cmpgt_epi32(_mm256_setzero_si256(), value),
+      _mm256_cmpgt_epi32(limit, value));
+}
+
+// the palette colors of the visible lanes, transparent elsewhere
+[[gnu::target("avx2")]] static inline void
+store_colors(uint16_t* out,
+             const uint16_t* palette,
+             __m256i index,
+             __m256i visible) {
+    __m256i colors = _mm256_blendv_epi8(_mm256_set1_epi32(TRANSPARENT_RGB555),
+                                        gather_u16(palette, index, visible),
+                                        visible);
+
+    _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(out),
+      _mm_packus_epi32(_mm256_castsi256_si128(colors),
+                       _mm256_extracti128_si256(colors, 1)));
+}
+
+[[gnu::target("avx2")]] void
+sample_affine_background_avx2(const AffineBackground& bg,
+                              std::span<uint16_t, LCD_WIDTH> line) {
+    static_assert(LCD_WIDTH % 8 == 0);
+
+    const __m256i lanes     = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i seven     = _mm256_set1_epi32(7);
+    const __m256i size      = _mm256_set1_epi32(bg.size);
+    const __m256i size_mask = _mm256_set1_epi32(bg.size - 1);
+    const __m256i map_shift =
+      _mm256_set1_epi32(std::countr_zero<uint32_t>(bg.size / TILE_SIZE));
+
+    __m256i x = _mm256_add_epi32(
+      _mm256_set1_epi32(bg.origin.x),
+      _mm256_mullo_epi32(lanes, _mm256_set1_epi32(bg.step.x)));
+    __m256i y = _mm256_add_epi32(
+      _mm256_set1_epi32(bg.origin.y),
+      _mm256_mullo_epi32(lanes, _mm256_set1_epi32(bg.step.y)));
+    const __m256i step_x = _mm256_set1_epi32(bg.step.x * 8);
+    const __m256i step_y = _mm256_set1_epi32(bg.step.y * 8);
+
+    for (int i = 0; i < LCD_WIDTH; i += 8) {
+        __m256i texel_x = _mm256_srai_epi32(x, 8);
+        __m256i texel_y = _mm256_srai_epi32(y, 8);
+        __m256i inside;
+
+        if (bg.wraparound) {
+            texel_x = _mm256_and_si256(texel_x, size_mask);
+            texel_y = _mm256_and_si256(texel_y, size_mask);
+            inside  = _mm256_set1_epi32(-1);
+        } else {
+            inside = _mm256_and_si256(in_range(texel_x, size),
+                                      in_range(texel_y, size));
+        }
+
+        __m256i map_address = _mm256_add_epi32(
+          _mm256_set1_epi32(bg.map_base),
+          _mm256_add_epi32(
+            _mm256_srli_epi32(texel_x, 3),
+            _mm256_sllv_epi32(_mm256_srli_epi32(texel_y, 3), map_shift)));
+        __m256i tile = gather_u8(bg.vram, map_address, inside);
+
+        __m256i address = _mm256_add_epi32(
+          _mm256_add_epi32(_mm256_set1_epi32(bg.tile_base),
+                           _mm256_slli_epi32(tile, 6)),
+          _mm256_add_epi32(
+            _mm256_slli_epi32(_mm256_and_si256(texel_y, seven), 3),
+            _mm256_and_si256(texel_x, seven)));
+        __m256i index = gather_u8(bg.vram, address, inside);
+
+        __m256i visible = _mm256_andnot_si256(
+          _mm256_cmpeq_epi32(index, _mm256_setzero_si256()), inside);
+
+        store_colors(&line[i], bg.palette, index, visible);
+
+        x = _mm256_add_epi32(x, step_x);
+        y = _mm256_add_epi32(y, step_y);
+    }
+}
+
+[[gnu::target("avx2")]] void
+sample_affine_object_avx2(const AffineObject& obj, std::span<uint16_t> pixels) {
+    const __m256i lanes     = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i seven     = _mm256_set1_epi32(7);
+    const __m256i width     = _mm256_set1_epi32(obj.size.x);
+    const __m256i height    = _mm256_set1_epi32(obj.size.y);
+    const __m256i vram_size = _mm256_set1_epi32(obj.vram_size);
+    const __m256i palette_offset = _mm256_set1_epi32(obj.palette_offset);
+    const __m256i tiles_per_row  = _mm256_set1_epi32(obj.tiles_per_row);
+    const __m256i tile_shift     = _mm256_set1_epi32(obj.colors256 ? 6 : 5);
+
+    __m256i x = _mm256_add_epi32(
+      _mm256_set1_epi32(obj.origin.x),
+      _mm256_mullo_epi32(lanes, _mm256_set1_epi32(obj.step.x)));
+    __m256i y = _mm256_add_epi32(
+      _mm256_set1_epi32(obj.origin.y),
+      _mm256_mullo_epi32(lanes, _mm256_set1_epi32(obj.step.y)));
+    const __m256i step_x = _mm256_set1_epi32(obj.step.x * 8);
+    const __m256i step_y = _mm256_set1_epi32(obj.step.y * 8);
+
+    for (size_t i = 0; i < pixels.size(); i += 8) {
+        __m256i texel_x = _mm256_add_epi32(_mm256_srai_epi32(x, 8),
+                                           _mm256_set1_epi32(obj.size.x / 2));
+        __m256i texel_y = _mm256_add_epi32(_mm256_srai_epi32(y, 8),
+                                           _mm256_set1_epi32(obj.size.y / 2));
+
+        __m256i remaining = _mm256_set1_epi32(pixels.size() - i);
+        __m256i inside    = _mm256_and_si256(
+          _mm256_cmpgt_epi32(remaining, lanes),
+          _mm256_and_si256(in_range(texel_x, width),
+                           in_range(texel_y, height)));
+
+        __m256i tile = _mm256_add_epi32(
+          _mm256_srli_epi32(texel_x, 3),
+          _mm256_mullo_epi32(_mm256_srli_epi32(texel_y, 3), tiles_per_row));
+        __m256i pixel = _mm256_add_epi32(
+          _mm256_slli_epi32(_mm256_and_si256(texel_y, seven), 3),
+          _mm256_and_si256(texel_x, seven));
+
+        if (!obj.colors256) {
+            pixel = _mm256_srli_epi32(pixel, 1);
+        }
+
+        __m256i address =
+          _mm256_add_epi32(_mm256_set1_epi32(obj.tile_base),
+                           _mm256_add_epi32(_mm256_sllv_epi32(tile, tile_shift),
+                                            pixel));
+
+        /* tiles past the end of VRAM are transparent */
+        inside = _mm256_and_si256(inside, in_range(address, vram_size));
+
+        __m256i index = gather_u8(obj.vram, address, inside);
+
+        if (!obj.colors256) {
+            __m256i shift = _mm256_slli_epi32(
+              _mm256_and_si256(texel_x, _mm256_set1_epi32(1)), 2);
+            index = _mm256_and_si256(_mm256_srlv_epi32(index, shift),
+                                     _mm256_set1_epi32(0xF));
+        }
+
+        __m256i visible = _mm256_andnot_si256(
+          _mm256_cmpeq_epi32(index, _mm256_setzero_si256()), inside);
+
+        if (i + 8 <= pixels.size()) {
+            store_colors(&pixels[i],
+                         obj.palette,
+                         _mm256_add_epi32(index, palette_offset),
+                         visible);
+        } else {
+            std::array<uint16_t, 8> rest;
+
+            store_colors(rest.data(),
+                         obj.palette,
+                         _mm256_add_epi32(index, palette_offset),
+                         visible);
+            std::copy_n(rest.begin(), pixels.size() - i, &pixels[i]);
+        }
+
+        x = _mm256_add_epi32(x, step_x);
+        y = _mm256_add_epi32(y, step_y);
+    }
+}
+
+bool
+has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+void
+sample_affine_background(const AffineBackground& bg,
+                         std::span<uint16_t, LCD_WIDTH> line) {
+#ifdef AFFINE_AVX2
+    if (has_avx2()) {
+        sample_affine_background_avx2(bg, line);
+        return;
+    }
+#endif
+
+    sample_affine_background_scalar(bg, line);
+}
+
+void
+sample_affine_object(const AffineObject& obj, std::span<uint16_t> pixels) {
+#ifdef AFFINE_AVX2
+    if (has_avx2()) {
+        sample_affine_object_avx2(obj, pixels);
+        return;
+    }
+#endif
+
+    sample_affine_object_scalar(obj, pixels);
+}
+}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "io/display/affine.hh"
+#include <cstdint>
+#include <span>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AFFINE_AVX2
+#endif
+
+// The samplers sample_affine_background and sample_affine_object pick
+// between, kept apart so that tests can check them against each other
+namespace matar {
+namespace display {
+void
+sample_affine_background_scalar(const AffineBackground& bg,
+                                std::span<uint16_t, LCD_WIDTH> line);
+void
+sample_affine_object_scalar(const AffineObject& obj,
+                            std::span<uint16_t> pixels);
+
+#ifdef AFFINE_AVX2
+// only to be called if has_avx2()
+[[gnu::target("avx2")]] void
+sample_affine_background_avx2(const AffineBackground& bg,
+                              std::span<uint16_t, LCD_WIDTH> line);
+[[gnu::target("avx2")]] void
+sample_affine_object_avx2(const AffineObject& obj, std::span<uint16_t> pixels);
+
+bool
+has_avx2();
+#endif
+}
+}
@@ -0,0 +1,347 @@
+#include "io/display/capture.hh"
+#include "util/deflate.hh"
+#include "util/hash.hh"
+#include "util/log.hh"
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <ios>
+
+namespace matar {
+namespace display {
+
+template<PixelFormat FORMAT>
+static void
+row_colors(const uint8_t* row, uint32_t width, uint16_t* colors) {
+    for (uint32_t x = 0; x < width; x++) {
+        HostPixel<FORMAT> pixel;
+
+        std::memcpy(&pixel, row + x * sizeof(pixel), sizeof(pixel));
+        colors[x] = from_host_pixel<FORMAT>(pixel);
+    }
+}
+
+/* the frame back in GBA colors, one row after another */
+static void
+frame_colors(const Frame& frame, std::vector<uint16_t>& colors) {
+    colors.resize(frame.width * frame.height);
+
+    for (uint32_t y = 0; y < frame.height; y++) {
+        const uint8_t* row = frame.pixels.data() + y * frame.pitch;
+        uint16_t* out      = colors.data() + y * frame.width;
+
+        switch (frame.format) {
+            case PixelFormat::RGB555:
+                row_colors<PixelFormat::RGB555>(row, frame.width, out);
+                break;
+            case PixelFormat::RGB565:
+                row_colors<PixelFormat::RGB565>(row, frame.width, out);
+                break;
+            case PixelFormat::RGBA8888:
+                row_colors<PixelFormat::RGBA8888>(row, frame.width, out);
+                break;
+            case PixelFormat::BGRA8888:
+                row_colors<PixelFormat::BGRA8888>(row, frame.width, out);
+                break;
+        }
+    }
+}
+
+/* 8 bits per channel out of 5 */
+static constexpr uint8_t
+widen8(uint32_t channel) {
+    return channel << 3 | channel >> 2;
+}
+
+Y4mSink::Y4mSink(const std::string& path)
+  : file(std::fopen(path.c_str(), "wb")) {
+    if (file == nullptr) {
+        throw std::ios::failure("Could not open " + path, std::error_code());
+    }
+}
+
+Y4mSink::~Y4mSink() {
+    std::fclose(file);
+}
+
+void
+Y4mSink::consume(const Frame& frame) {
+    /* Y, Cb and Cr of every GBA color in the BT.601 studio range, a byte
+     * each from the bottom up */
+    static const std::vector<uint32_t> YUV = [] {
+        std::vector<uint32_t> table(0x8000);
+
+        for (uint32_t color = 0; color < table.size(); color++) {
+            const int32_t r = widen8(color & 0x1F);
+            const int32_t g = widen8(color >> 5 & 0x1F);
+            const int32_t b = widen8(color >> 10 & 0x1F);
+
+            /* the coefficients are fixed point, shifted by 8 */
+            auto scale = [](int32_t sum) { return (sum + 128) >> 8; };
+
+            const uint32_t y  = 16 + scale(66 * r + 129 * g + 25 * b);
+            const uint32_t cb = 128 + scale(-38 * r - 74 * g + 112 * b);
+            const uint32_t cr = 128 + scale(112 * r - 94 * g - 18 * b);
+
+            table[color] = y | cb << 8 | cr << 16;
+        }
+
+        return table;
+    }();
+
+    /* GBA frames are 280896 cycles at 16.78 MHz, a little under 60 a
+     * second */
+    if (!header_written) {
+        std::fprintf(file,
+                     "YUV4MPEG2 W%u H%u F262144:4389 Ip A1:1 C444\n",
+                     frame.width,
+                     frame.height);
+        header_written = true;
+    }
+
+    frame_colors(frame, colors);
+
+    const size_t plane = colors.size();
+    planes.resize(plane * 3);
+
+    for (size_t i = 0; i < plane; i++) {
+        const uint32_t yuv = YUV[colors[i] & 0x7FFF];
+
+        planes[i]             = yuv;
+        planes[plane + i]     = yuv >> 8;
+        planes[plane * 2 + i] = yuv >> 16;
+    }
+
+    if (std::fputs("FRAME\n", file) < 0 ||
+        std::fwrite(planes.data(), 1, planes.size(), file) != planes.size()) {
+        glogger.error("Failed to write frame {}", frame.number);
+    }
+}
+
+PngSink::PngSink(std::string prefix)
+  : prefix(std::move(prefix)) {}
+
+static void
+put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+static void
+put_chunk(std::vector<uint8_t>& png,
+          const char (&type)[5],
+          std::span<const uint8_t> data) {
+    put_u32(png, data.size());
+
+    const size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+
+    put_u32(png, deflate::crc32(std::span(png).subspan(start)));
+}
+
+void
+PngSink::consume(const Frame& frame) {
+    static constexpr uint32_t BYTES_PER_PIXEL = 3;
+    static constexpr std::array<uint8_t, 8> SIGNATURE = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'
+    };
+
+    frame_colors(frame, colors);
+
+    const uint32_t stride = frame.width * BYTES_PER_PIXEL;
+    std::vector<uint8_t> row(stride), above(stride);
+    /* rows with their filter in front */
+    std::vector<uint8_t> filtered(stride + 1), best(stride + 1);
+
+    scanlines.clear();
+    scanlines.reserve((stride + 1) * frame.height);
+
+    auto paeth = [](int32_t left, int32_t up, int32_t up_left) {
+        const int32_t p  = left + up - up_left;
+        const int32_t pa = std::abs(p - left);
+        const int32_t pb = std::abs(p - up);
+        const int32_t pc = std::abs(p - up_left);
+
+        return pa <= pb && pa <= pc ? left : pb <= pc ? up : up_left;
+    };
+
+    for (uint32_t y = 0; y < frame.height; y++) {
+        for (uint32_t x = 0; x < frame.width; x++) {
+            const uint16_t color = colors[y * frame.width + x];
+
+            row[x * 3]     = widen8(color & 0x1F);
+            row[x * 3 + 1] = widen8(color >> 5 & 0x1F);
+            row[x * 3 + 2] = widen8(color >> 10 & 0x1F);
+        }
+
+        /* pick the filter leaving the smallest differences, which tends to
+         * compress best */
+        uint64_t best_sum = UINT64_MAX;
+
+        for (uint8_t filter = 0; filter < 5; filter++) {
+            uint64_t sum = 0;
+
+            filtered[0] = filter;
+
+            for (uint32_t i = 0; i < stride; i++) {
+                const int32_t left =
+                  i >= BYTES_PER_PIXEL ? row[i - BYTES_PER_PIXEL] : 0;
+                const int32_t up = above[i];
+                const int32_t up_left =
+                  i >= BYTES_PER_PIXEL ? above[i - BYTES_PER_PIXEL] : 0;
+
+                int32_t prediction = 0;
+
+                switch (filter) {
+                    case 1:
+                        prediction = left;
+                        break;
+                    case 2:
+                        prediction = up;
+                        break;
+                    case 3:
+                        prediction = (left + up) / 2;
+                        break;
+                    case 4:
+                        prediction = paeth(left, up, up_left);
+                        break;
+                }
+
+                const auto value = static_cast<uint8_t>(row[i] - prediction);
+
+                filtered[i + 1] = value;
+                sum += value < 128 ? value : 256 - value;
+            }
+
+            if (sum < best_sum) {
+                best_sum = sum;
+                std::swap(filtered, best);
+            }
+        }
+
+        scanlines.insert(scanlines.end(), best.begin(), best.end());
+        std::swap(row, above);
+    }
+
+    std::vector<uint8_t> png(SIGNATURE.begin(), SIGNATURE.end());
+    std::vector<uint8_t> header;
+
+    put_u32(header, frame.width);
+    put_u32(header, frame.height);
+    /* 8 bits per channel, RGB, deflate, adaptive filtering, no interlace */
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });
+
+    put_chunk(png, "IHDR", header);
+    put_chunk(png, "IDAT", deflate::zlib_compress(scanlines));
+    put_chunk(png, "IEND", {});
+
+    const std::string path = std::format("{}{:06}.png", prefix, frame.number);
+    std::FILE* file        = std::fopen(path.c_str(), "wb");
+
+    if (file == nullptr) {
+        glogger.error("Could not open {}", path);
+        return;
+    }
+
+    if (std::fwrite(png.data(), 1, png.size(), file) != png.size()) {
+        glogger.error("Failed to write frame {}", frame.number);
+    }
+
+    std::fclose(file);
+}
+
+HashLogSink::HashLogSink(const std::string& path,
+                         std::function<uint64_t()> audio_hash)
+  : file(std::fopen(path.c_str(), "w"))
+  , audio_hash(std::move(audio_hash)) {
+    if (file == nullptr) {
+        throw std::ios::failure("Could not open " + path, std::error_code());
+    }
+}
+
+HashLogSink::~HashLogSink() {
+    std::fclose(file);
+}
+
+void
+HashLogSink::consume(const Frame& frame) {
+    std::string line =
+      std::format("{} {:016x}", frame.number, hash::xxh64(frame.pixels));
+
+    if (audio_hash) {
+        line += std::format(" {:016x}", audio_hash());
+    }
+
+    line += '\n';
+
+    if (std::fputs(line.c_str(), file) < 0) {
+        glogger.error("Failed to write hash of frame {}", frame.number);
+    }
+}
+
+QueuedSink::QueuedSink(FrameSink& sink, uint32_t depth)
+  : sink(sink)
+  , pixels(depth)
+  , frames(depth)
+  , queued(depth)
+  , free(depth) {
+    for (uint32_t slot = 0; slot < depth; slot++) {
+        free.push(slot);
+    }
+
+    thread = std::thread(&QueuedSink::run, this);
+}
+
+QueuedSink::~QueuedSink() {
+    stopping = true;
+    wakeups.fetch_add(1);
+    wakeups.notify_one();
+    thread.join();
+}
+
+void
+QueuedSink::consume(const Frame& frame) {
+    uint32_t slot;
+
+    if (!free.pop(slot)) {
+        drops.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    pixels[slot].assign(frame.pixels.begin(), frame.pixels.end());
+    frames[slot]        = frame;
+    frames[slot].pixels = pixels[slot];
+
+    /* there are only as many slots as fit in the queue */
+    queued.push(slot);
+
+    wakeups.fetch_add(1);
+    wakeups.notify_one();
+}
+
+void
+QueuedSink::run() {
+    uint64_t seen = 0;
+
+    while (true) {
+        wakeups.wait(seen);
+        seen = wakeups.load();
+
+        uint32_t slot;
+
+        while (queued.pop(slot)) {
+            sink.consume(frames[slot]);
+            free.push(slot);
+        }
+
+        /* what was queued is still handed over before stopping */
+        if (stopping) {
+            break;
+        }
+    }
+}
+}
+}
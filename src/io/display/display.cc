@@ -6,6 +6,7 @@
 #include "util/log.hh"
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 
 namespace matar {
@@ -16,13 +17,20 @@ static constexpr uint32_t CYCLES_HBLANK = 226;
 
 static constexpr uint32_t VDRAW_LINES  = LCD_HEIGHT;
 static constexpr uint32_t VBLANK_LINES = 68;
-uint64_t frames                        = 0;
 static constexpr uint32_t VTOTAL_LINES = VDRAW_LINES + VBLANK_LINES;
 
-Display::Display(Scheduler& scheduler, System& system, Dma& dma)
+Display::Display(Scheduler& scheduler,
+                 System& system,
+                 Dma& dma,
+                 MemoryArena* arena)
   : scheduler(scheduler)
   , system(system)
-  , dma(dma) {
+  , dma(dma)
+  , pram(arena_memory<PRAM_SIZE>(arena))
+  , vram(arena_memory<VRAM_SIZE>(arena))
+  , oam(arena_memory<OAM_SIZE>(arena))
+  , tiles(vram.data()) {
+    update_layers();
     scheduler.schedule_from_now(Task::Type::DISPLAY_HBLANK, CYCLES_HDRAW);
     scheduler.empty();
 }
@@ -51,7 +59,9 @@ Display::hblank_end(uint64_t at) {
 
     /* within vdraw */
     if (vertical_counter < VDRAW_LINES) {
-        render_line();
+        if (render_frame) {
+            update_line();
+        }
 
         bg2_rot_scale.internal.x += bg2_rot_scale.b;
         bg2_rot_scale.internal.y += bg2_rot_scale.d;
@@ -76,6 +86,23 @@ Display::hblank_end(uint64_t at) {
 void
 Display::vblank_begin() {
     lcd_status.value.vblank_flag = true;
+    frames++;
+
+    if (render_frame) {
+        previous_frame = frame_buffers.back();
+    }
+
+    if (sink != nullptr && render_frame) {
+        frame_buffers.publish(pixel_format, frames);
+
+        if (sink_thread) {
+            sink_thread->notify();
+        } else {
+            sink->consume(*frame_buffers.acquire());
+        }
+    }
+
+    render_frame = render_next_frame();
 
     bg2_rot_scale.internal.x = bg2_rot_scale.ref.x;
     bg2_rot_scale.internal.y = bg2_rot_scale.ref.y;
@@ -86,62 +113,126 @@ Display::vblank_begin() {
     if (lcd_status.value.vblank_irq_enable) {
         system.raise_irq(System::Irq::LCD_VBLANK);
     }
+}
 
-    for (auto& row : object_buffer) {
-        for (auto& pixel : row) {
-            pixel.reset();
-        }
+void
+Display::vblank_end() {
+    lcd_status.value.vblank_flag = false;
+    vertical_counter             = 0;
+
+    if (render_frame) {
+        update_line();
+    }
+
+    if (lcd_status.value.vcounter_irq_enable &&
+        lcd_status.value.vcount_setting == 0) {
+        system.raise_irq(System::Irq::LCD_VCOUNTER_MATCH);
     }
 }
 
-void
-dump_frame(const uint16_t* src, FILE* f) {
-    uint8_t rgb[240 * 160 * 3];
+Display::LineInputs
+Display::line_inputs() const {
+    LineInputs inputs = {};
+    const auto& control = lcd_control.value;
 
-    for (int i = 0; i < 240 * 160; ++i) {
-        uint16_t p = src[i];
+    if (!control.forced_blank) {
+        /* the backdrop is always drawn */
+        inputs.pram[0] = pram_generation[0];
 
-        uint8_t r = (p >> 10) & 0x1f;
-        uint8_t g = (p >> 5) & 0x1f;
-        uint8_t b = (p >> 0) & 0x1f;
+        if (control.enable_bg_0 || control.enable_bg_1 || control.enable_bg_2 ||
+            control.enable_bg_3) {
+            inputs.vram[BgVram] = vram_generation[BgVram];
 
-        // Expand 5-bit [0,31] to 8-bit [0,255]
-        rgb[i * 3 + 0] = (r << 3) | (r >> 2);
-        rgb[i * 3 + 1] = (g << 3) | (g >> 2);
-        rgb[i * 3 + 2] = (b << 3) | (b >> 2);
+            if (control.mode >= 3) {
+                inputs.vram[SharedVram] = vram_generation[SharedVram];
+            }
+        }
+
+        if (control.enable_obj) {
+            inputs.vram[ObjVram] = vram_generation[ObjVram];
+            inputs.pram[1]       = pram_generation[1];
+            inputs.oam           = oam_generation;
+
+            if (control.mode < 3) {
+                inputs.vram[SharedVram] = vram_generation[SharedVram];
+            }
+        }
     }
 
-    fwrite(rgb, 1, sizeof(rgb), f);
+    auto pack = [](uint32_t low, uint32_t high) { return low | high << 16; };
+    auto pack_rot_scale = [](const RotationScaling& r) {
+        return std::array<uint32_t, 4>{
+            static_cast<u16>(r.a) | static_cast<uint32_t>(r.b) << 16,
+            static_cast<u16>(r.c) | static_cast<uint32_t>(r.d) << 16,
+            static_cast<uint32_t>(r.internal.x),
+            static_cast<uint32_t>(r.internal.y),
+        };
+    };
+
+    const auto bg2 = pack_rot_scale(bg2_rot_scale);
+    const auto bg3 = pack_rot_scale(bg3_rot_scale);
+
+    inputs.registers = {
+        lcd_control.read(),
+        pack(bg_control[0].read(), bg_control[1].read()),
+        pack(bg_control[2].read(), bg_control[3].read()),
+        pack(bg_offset[0].x, bg_offset[0].y),
+        pack(bg_offset[1].x, bg_offset[1].y),
+        pack(bg_offset[2].x, bg_offset[2].y),
+        pack(bg_offset[3].x, bg_offset[3].y),
+        bg2[0],
+        bg2[1],
+        bg2[2],
+        bg2[3],
+        bg3[0],
+        bg3[1],
+        bg3[2],
+        bg3[3],
+        pack(win0_top_left.x | win0_top_left.y << 8,
+             win0_bot_right.x | win0_bot_right.y << 8),
+        pack(win1_top_left.x | win1_top_left.y << 8,
+             win1_bot_right.x | win1_bot_right.y << 8),
+        pack(win0.read() | win1.read() << 8,
+             win_out.read() | win_obj.read() << 8),
+        pack(mosaic_size, brightness_coeff),
+        pack(blend_control.read(), alpha_coeff.read()),
+    };
+    inputs.format = static_cast<uint32_t>(pixel_format);
+
+    return inputs;
 }
 
 void
-Display::vblank_end() {
-    lcd_status.value.vblank_flag = false;
-    vertical_counter             = 0;
+Display::update_line() {
+    const uint y            = vertical_counter;
+    const LineInputs inputs = line_inputs();
 
-    render_line();
+    if (inputs == drawn_inputs[y] && previous_frame != nullptr) {
+        const uint32_t pitch = LCD_WIDTH * bytes_per_pixel(pixel_format);
+        uint8_t* out         = frame_buffers.back() + y * pitch;
 
-    if (lcd_status.value.vcounter_irq_enable &&
-        lcd_status.value.vcount_setting == 0) {
-        system.raise_irq(System::Irq::LCD_VCOUNTER_MATCH);
+        /* nothing to do if drawing into the last frame again */
+        if (out != previous_frame + y * pitch) {
+            std::memcpy(out, previous_frame + y * pitch, pitch);
+        }
+
+        line_counts.reused++;
+        return;
     }
 
-    // std::cout << "frames: " << frames++ << std::endl;
+    render_line();
 
-    FILE* f = fopen("frames.raw", "ab");
-    fwrite(frame_buffer.begin(), sizeof(uint16_t), 240 * 160, f);
-    fclose(f);
+    drawn_inputs[y] = inputs;
+    line_counts.drawn++;
 }
 
 void
 Display::render_line() {
-    uint y = vertical_counter;
-    std::vector<uint8_t> bgs;
-
     if (lcd_control.value.forced_blank) {
+        std::array<u16, LCD_WIDTH> white;
 
-        for (int x = 0; x < LCD_WIDTH; x++)
-            frame_buffer[x + y * LCD_WIDTH] = 0xFFFF; // white
+        white.fill(0xFFFF);
+        write_line(white);
 
         return;
     }
@@ -150,22 +241,18 @@ Display::render_line() {
         case 0: {
             if (lcd_control.value.enable_bg_0) {
                 render_text_layer_line<0>();
-                bgs.push_back(0);
             }
 
             if (lcd_control.value.enable_bg_1) {
                 render_text_layer_line<1>();
-                bgs.push_back(1);
             }
 
             if (lcd_control.value.enable_bg_2) {
                 render_text_layer_line<2>();
-                bgs.push_back(2);
             }
 
             if (lcd_control.value.enable_bg_3) {
                 render_text_layer_line<3>();
-                bgs.push_back(3);
             }
 
             break;
@@ -173,17 +260,14 @@ Display::render_line() {
         case 1: {
             if (lcd_control.value.enable_bg_0) {
                 render_text_layer_line<0>();
-                bgs.push_back(0);
             }
 
             if (lcd_control.value.enable_bg_1) {
                 render_text_layer_line<1>();
-                bgs.push_back(1);
             }
 
             if (lcd_control.value.enable_bg_2) {
                 render_rot_scale_layer_line<2>();
-                bgs.push_back(2);
             }
 
             break;
@@ -192,12 +276,10 @@ Display::render_line() {
         case 2: {
             if (lcd_control.value.enable_bg_2) {
                 render_rot_scale_layer_line<2>();
-                bgs.push_back(2);
             }
 
             if (lcd_control.value.enable_bg_3) {
                 render_rot_scale_layer_line<3>();
-                bgs.push_back(3);
             }
 
             break;
@@ -205,21 +287,18 @@ Display::render_line() {
         case 3: {
             if (lcd_control.value.enable_bg_2) {
                 render_bitmap_mode_line<3>();
-                bgs.push_back(2);
             }
             break;
         }
         case 4: {
             if (lcd_control.value.enable_bg_2) {
                 render_bitmap_mode_line<4>();
-                bgs.push_back(2);
             }
             break;
         }
         case 5: {
             if (lcd_control.value.enable_bg_2) {
                 render_bitmap_mode_line<5>();
-                bgs.push_back(2);
             }
             break;
         }
@@ -228,168 +307,419 @@ Display::render_line() {
         }
     }
 
+    object_buffer.fill(ObjectPixel());
+
     if (lcd_control.value.enable_obj)
         render_objects_line();
 
-    std::ranges::stable_sort(bgs, [this](int a, int b) {
-        return bg_control[a].value.priority < bg_control[b].value.priority;
-    });
+    compose_line();
+}
 
-    bool y_in_win0 = y >= win0_top_left.y && y < win0_bot_right.y &&
-                     lcd_control.value.window_display_0;
-    bool y_in_win1 = y >= win1_top_left.y && y < win1_bot_right.y &&
-                     lcd_control.value.window_display_1;
+/* layer ids, these match the bit positions of the blend targets */
+static constexpr uint8_t LAYER_OBJ      = 4;
+static constexpr uint8_t LAYER_BACKDROP = 5;
+
+static constexpr uint8_t WINDOW_OBJ_ENABLE = 1 << 4;
+static constexpr uint8_t WINDOW_SFX_ENABLE = 1 << 5;
+
+enum SpecialEffects {
+    None       = 0b00,
+    AlphaBlend = 0b01,
+    BrightInc  = 0b10,
+    BrightDec  = 0b11
+};
+
+/* RGB555 is spread into 10 bit lanes so that all three channels can be
+ * weighted and summed at once, a channel times a coefficient of at most 16
+ * for both colors still fits in a lane */
+static constexpr uint32_t
+spread_rgb555(uint16_t color) {
+    return (color & 0x1F) | (color & 0x3E0) << 5 | (color & 0x7C00) << 10;
+}
 
-    uint16_t backdrop = pram.read_halfword(0);
+static constexpr uint16_t
+blend_rgb555(uint16_t a, uint16_t b, uint32_t eva, uint32_t evb) {
+    uint32_t sum = (spread_rgb555(a) * eva + spread_rgb555(b) * evb) >> 4;
 
-    for (int x = 0; x < LCD_WIDTH; x++) {
-        struct Pixel {
-            Color color;
-            uint8_t priority;
-            bool blend;
-        };
+    /* lanes are at most 62 after the shift, saturate the ones above 31 */
+    sum &= 0x03F0FC3F;
+    sum |= ((sum >> 5) & 0x00100401) * 0x1F;
+    sum &= 0x01F07C1F;
 
-        enum SpecialEffects {
-            None       = 0b00,
-            AlphaBlend = 0b01,
-            BrightInc  = 0b10,
-            BrightDec  = 0b11
-        };
+    return (sum & 0x1F) | (sum >> 5 & 0x3E0) | (sum >> 10 & 0x7C00);
+}
 
-        Pixel top    = { backdrop, 4, blend_control.top.backdrop },
-              bottom = { backdrop, 4, blend_control.bottom.backdrop };
+static_assert(blend_rgb555(0x7FFF, 0x7FFF, 16, 16) == 0x7FFF);
+static_assert(blend_rgb555(0x7C1F, 0x03E0, 8, 8) == 0x3DEF);
 
-        bool top_found = false;
+void
+Display::update_layers() {
+    /* backgrounds each mode draws, by bit */
+    static constexpr std::array<uint8_t, 8> MODE_BACKGROUNDS = {
+        0b1111, 0b0111, 0b1100, 0b0100, 0b0100, 0b0100, 0, 0,
+    };
+
+    const auto& control = lcd_control.value;
+    const uint8_t enabled =
+      MODE_BACKGROUNDS[control.mode] &
+      (control.enable_bg_0 | control.enable_bg_1 << 1 |
+       control.enable_bg_2 << 2 | control.enable_bg_3 << 3);
+
+    /* lower priorities are in front, ties go to the lower background */
+    layers.count = 0;
+
+    for (uint8_t priority = 0; priority < 4; priority++) {
+        for (uint8_t bg = 0; bg < N_BACKGROUNDS; bg++) {
+            if ((enabled >> bg & 1) &&
+                bg_control[bg].value.priority == priority) {
+                layers.order[layers.count++] = bg;
+            }
+        }
+    }
 
-        WindowControl window;
+    layers.windows = control.window_display_0 | control.window_display_1 << 1 |
+                     control.obj_window_display << 2;
+    layers.window_controls = {
+        win0.read(), win1.read(), win_out.read(), win_obj.read()
+    };
 
-        if (!lcd_control.value.window_display_0 &&
-            !lcd_control.value.window_display_1 &&
-            !lcd_control.value.obj_window_display) {
-            window.write(0xff);
-        } else if (y_in_win0 && x >= win0_top_left.x && x < win0_bot_right.x) {
-            window = win0;
-        } else if (y_in_win1 && x >= win1_top_left.x && x < win1_bot_right.x) {
-            window = win1;
-        } else if (lcd_control.value.obj_window_display &&
-                   object_buffer[x][y].is_window) {
-            window = win_obj;
-        } else {
-            window = win_out;
-        }
+    for (uint bg = 0; bg < N_BACKGROUNDS; bg++) {
+        layers.priorities[bg] = bg_control[bg].value.priority;
+    }
 
-        for (uint8_t bg : bgs) {
-            if (!get_bit(window.value.bg_enable, bg))
-                continue;
+    layers.priorities[LAYER_OBJ]      = 0;
+    layers.priorities[LAYER_BACKDROP] = 4;
 
-            if (scanline_buffers[bg][x].raw() == TRANSPARENT_RGB555) {
-                continue;
+    layers.first_targets  = std::bit_cast<uint8_t>(blend_control.top);
+    layers.second_targets = std::bit_cast<uint8_t>(blend_control.bottom);
+    layers.effects        = blend_control.top.sfx;
+}
+
+void
+Display::compose_line() {
+    const uint y = vertical_counter;
+
+    std::array<uint8_t, LCD_WIDTH> window;
+    std::array<u16, LCD_WIDTH> top, bottom;
+    std::array<uint8_t, LCD_WIDTH> top_layer, bottom_layer;
+    std::array<bool, LCD_WIDTH> obj_alpha = {};
+
+    /* window masks, innermost window is applied last */
+    if (layers.windows == 0) {
+        window.fill(0xFF);
+    } else {
+        window.fill(layers.window_controls[2]);
+
+        if (layers.windows & 0b100) {
+            const uint8_t inside = layers.window_controls[3];
+
+            for (int x = 0; x < LCD_WIDTH; x++) {
+                window[x] = object_buffer[x].is_window ? inside : window[x];
+            }
+        }
+
+        auto fill_window = [&window, y](uint8_t control,
+                                        Vec2<u8> top_left,
+                                        Vec2<u8> bot_right) {
+            if (y < top_left.y || y >= bot_right.y) {
+                return;
             }
 
-            if (!top_found) {
-                top       = Pixel{ scanline_buffers[bg][x],
-                             bg_control[bg].value.priority,
-                             blend_control.bg(true, bg) };
-                top_found = true;
-            } else {
-                bottom = Pixel{ scanline_buffers[bg][x],
-                                bg_control[bg].value.priority,
-                                blend_control.bg(false, bg) };
-
-                break;
+            int end = std::min<int>(bot_right.x, LCD_WIDTH);
+
+            if (top_left.x < end) {
+                std::fill(window.begin() + top_left.x,
+                          window.begin() + end,
+                          control);
             }
+        };
+
+        if (layers.windows & 0b010) {
+            fill_window(
+              layers.window_controls[1], win1_top_left, win1_bot_right);
         }
-        bool obj_alpha     = false;
-        ObjectPixel object = object_buffer[x][y];
-
-        if (lcd_control.value.enable_obj && window.value.obj_enable &&
-            object.color.raw() != TRANSPARENT_RGB555) {
-            auto priority = object_buffer[x][y].priority;
-            if (priority <= top.priority) {
-                bottom = top;
-                top    = Pixel{ object.color, priority, blend_control.top.obj };
-                obj_alpha = object.is_alpha;
-            } else if (priority <= bottom.priority)
-                bottom =
-                  Pixel{ object.color, priority, blend_control.bottom.obj };
+
+        if (layers.windows & 0b001) {
+            fill_window(
+              layers.window_controls[0], win0_top_left, win0_bot_right);
         }
+    }
 
-        size_t idx = y * LCD_WIDTH + x;
-
-        SpecialEffects sfx = static_cast<SpecialEffects>(blend_control.top.sfx);
-
-        if (window.value.special_effects && top.blend) {
-            if (obj_alpha && bottom.blend) {
-                glogger.error("WHAR");
-                frame_buffer[idx] = top.color
-                                      .blend(bottom.color,
-                                             alpha_coeff.value.eva,
-                                             alpha_coeff.value.evb)
-                                      .raw();
-            } else {
-                switch (sfx) {
-                    case SpecialEffects::AlphaBlend: {
-                        if (bottom.blend) {
-                            frame_buffer[idx] =
-                              top.color
-                                .blend(
-                                  bottom.color,
-                                  std::min<uint>(alpha_coeff.value.eva, 16),
-                                  std::min<uint>(alpha_coeff.value.evb, 16))
-                                .raw();
-                            break;
-                        }
-                        [[fallthrough]];
-                    }
-                    case SpecialEffects::None: {
-                        frame_buffer[idx] = top.color.raw();
-                        break;
-                    }
-                    case SpecialEffects::BrightDec: {
-                        auto evy = std::min<uint>(brightness_coeff, 16);
-                        frame_buffer[idx] =
-                          top.color.blend(Color(0), 16 - evy, evy).raw();
-                        break;
-                    }
-                    case SpecialEffects::BrightInc: {
-                        auto evy = std::min<uint>(brightness_coeff, 16);
-                        frame_buffer[idx] =
-                          top.color.blend(Color(0x7FFF), 16 - evy, evy).raw();
-                        break;
-                    }
-                }
-            }
+    /* top and bottom layers, painted back to front so that every visible
+     * pixel pushes the previous top down */
+    const u16 backdrop = palette[0];
 
-        } else {
-            frame_buffer[idx] = top.color.raw();
+    top.fill(backdrop);
+    bottom.fill(backdrop);
+    top_layer.fill(LAYER_BACKDROP);
+    bottom_layer.fill(LAYER_BACKDROP);
+
+    for (int i = layers.count - 1; i >= 0; i--) {
+        const uint8_t layer  = layers.order[i];
+        const auto& line     = scanline_buffers[layer];
+        const uint8_t enable = 1 << layer;
+
+        for (int x = 0; x < LCD_WIDTH; x++) {
+            bool visible =
+              !(line[x] & TRANSPARENT_RGB555) && (window[x] & enable);
+
+            bottom[x]       = visible ? top[x] : bottom[x];
+            bottom_layer[x] = visible ? top_layer[x] : bottom_layer[x];
+            top[x]          = visible ? line[x] : top[x];
+            top_layer[x]    = visible ? layer : top_layer[x];
         }
     }
+
+    /* objects go in front of layers with the same priority */
+    if (lcd_control.value.enable_obj) {
+        const auto& priorities = layers.priorities;
+
+        for (int x = 0; x < LCD_WIDTH; x++) {
+            const ObjectPixel& object = object_buffer[x];
+            const u16 color           = object.color.raw();
+
+            bool visible = (window[x] & WINDOW_OBJ_ENABLE) &&
+                           color != TRANSPARENT_RGB555;
+            bool over_top =
+              visible && object.priority <= priorities[top_layer[x]];
+            bool over_bottom = visible && !over_top &&
+                               object.priority <= priorities[bottom_layer[x]];
+
+            bottom[x]       = over_top      ? top[x]
+                              : over_bottom ? color
+                                            : bottom[x];
+            bottom_layer[x] = over_top      ? top_layer[x]
+                              : over_bottom ? LAYER_OBJ
+                                            : bottom_layer[x];
+            top[x]          = over_top ? color : top[x];
+            top_layer[x]    = over_top ? LAYER_OBJ : top_layer[x];
+            obj_alpha[x]    = over_top && object.is_alpha;
+        }
+    }
+
+    /* special effects for the whole line */
+    const uint8_t first_targets  = layers.first_targets;
+    const uint8_t second_targets = layers.second_targets;
+    const auto sfx = static_cast<SpecialEffects>(layers.effects);
+
+    const uint32_t eva = std::min<uint>(alpha_coeff.value.eva, 16);
+    const uint32_t evb = std::min<uint>(alpha_coeff.value.evb, 16);
+    const uint32_t evy = std::min<uint>(brightness_coeff, 16);
+    const u16 bright   = sfx == SpecialEffects::BrightInc ? 0x7FFF : 0;
+    const bool brighten =
+      sfx == SpecialEffects::BrightInc || sfx == SpecialEffects::BrightDec;
+
+    std::array<u16, LCD_WIDTH> out;
+
+    for (int x = 0; x < LCD_WIDTH; x++) {
+        bool effects = (window[x] & WINDOW_SFX_ENABLE) &&
+                       ((first_targets >> top_layer[x]) & 1);
+        bool alpha = effects && ((second_targets >> bottom_layer[x]) & 1) &&
+                     (obj_alpha[x] || sfx == SpecialEffects::AlphaBlend);
+        bool brightness = effects && !alpha && brighten;
+
+        u16 blended = blend_rgb555(top[x],
+                                   alpha ? bottom[x] : bright,
+                                   alpha ? eva : 16 - evy,
+                                   alpha ? evb : evy);
+
+        out[x] = alpha || brightness ? blended : top[x];
+    }
+
+    write_line(out);
 }
 
-// if 16th bit is set, this will denote the transparent color in rgb555 format
-uint8_t
-Display::read_color_index(size_t address,
-                          size_t x,
-                          size_t y,
-                          ColorDepth depth) {
-    uint8_t color_index;
-
-    if (depth == ColorDepth::BPP4) {
-        address += ((y * 8) + x) / 2;
-        color_index = vram.read_byte(address);
-
-        if (x & 1)
-            color_index >>= 4;
-        else
-            color_index &= 0xF;
-    } else {
-        address += (y * 8) + x;
-        color_index = vram.read_byte(address);
+template<PixelFormat FORMAT>
+static void
+convert_line(std::span<const uint16_t, LCD_WIDTH> colors, uint8_t* out) {
+    std::array<HostPixel<FORMAT>, LCD_WIDTH> pixels;
+
+    for (int x = 0; x < LCD_WIDTH; x++) {
+        pixels[x] = to_host_pixel<FORMAT>(colors[x]);
+    }
+
+    std::memcpy(out, pixels.data(), sizeof(pixels));
+}
+
+void
+Display::write_line(std::span<const u16, LCD_WIDTH> colors) {
+    const uint32_t pitch = LCD_WIDTH * bytes_per_pixel(pixel_format);
+    uint8_t* out         = frame_buffers.back() + vertical_counter * pitch;
+
+    switch (pixel_format) {
+        case PixelFormat::RGB555:
+            convert_line<PixelFormat::RGB555>(colors, out);
+            break;
+        case PixelFormat::RGB565:
+            convert_line<PixelFormat::RGB565>(colors, out);
+            break;
+        case PixelFormat::RGBA8888:
+            convert_line<PixelFormat::RGBA8888>(colors, out);
+            break;
+        case PixelFormat::BGRA8888:
+            convert_line<PixelFormat::BGRA8888>(colors, out);
+            break;
+    }
+}
+
+void
+Display::set_frame_sink(FrameSink* sink, bool threaded) {
+    /* the old thread may still be handing a frame to the old sink */
+    sink_thread.reset();
+
+    this->sink = sink;
+
+    if (sink != nullptr && threaded) {
+        sink_thread = std::make_unique<SinkThread>(frame_buffers, *sink);
+    }
+}
+
+void
+Display::set_frame_skip(const FrameSkip& skip) {
+    frame_skip     = skip;
+    skipped_frames = 0;
+    budget_frames  = 0;
+
+    /* the frame under way is left alone, unless none are to be drawn */
+    if (skip.every == 0) {
+        render_frame = false;
+    }
+}
+
+bool
+Display::render_next_frame() {
+    const uint32_t every = frame_skip.every;
+
+    if (every == 0) {
+        return false;
+    }
+
+    if (frame_skip.budget.count() == 0) {
+        return frames % every == 0;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (budget_frames++ == 0) {
+        budget_start = now;
+    }
+
+    auto behind = now - budget_start -
+                  frame_skip.budget * static_cast<int64_t>(budget_frames);
+
+    /* forget about lag beyond what skipping a full run of frames could
+     * catch up on, or a single stall would have it skip for a long time */
+    const auto most_behind = frame_skip.budget * every;
+
+    if (behind > most_behind) {
+        budget_start += behind - most_behind;
+        behind = most_behind;
+    }
+
+    /* and about time saved beyond a frame, or a fast stretch would have a
+     * later slowdown draw every frame until it used the time up */
+    const auto most_ahead = -frame_skip.budget;
+
+    if (behind < most_ahead) {
+        budget_start += behind - most_ahead;
+        behind = most_ahead;
+    }
+
+    bool render    = behind <= behind.zero() || skipped_frames + 1 >= every;
+    skipped_frames = render ? 0 : skipped_frames + 1;
+
+    return render;
+}
+
+void
+Display::pram_written(uint32_t address) {
+    /* refresh both colors of the word, no write is wider */
+    address &= ~3;
+
+    palette[address / 2]     = pram.read_halfword(address) & 0x7FFF;
+    palette[address / 2 + 1] = pram.read_halfword(address + 2) & 0x7FFF;
+
+    pram_generation[address < PRAM_SIZE / 2 ? 0 : 1]++;
+}
+
+void
+Display::save(StateWriter& state) const {
+    state.put(frames);
+
+    state.put(lcd_control);
+    state.put(lcd_status);
+    state.put(vertical_counter);
+    state.put(bg_control);
+    state.put(bg_offset);
+    state.put(bg2_rot_scale);
+    state.put(bg3_rot_scale);
+    state.put(win0_top_left);
+    state.put(win0_bot_right);
+    state.put(win1_top_left);
+    state.put(win1_bot_right);
+    state.put(win0);
+    state.put(win1);
+    state.put(win_out);
+    state.put(win_obj);
+    state.put(mosaic_size);
+    state.put(blend_control);
+    state.put(alpha_coeff);
+    state.put(brightness_coeff);
+
+    state.put_memory(pram.data());
+    state.put_memory(vram.data());
+    state.put_memory(oam.data());
+}
+
+void
+Display::load(StateReader& state) {
+    state.get(frames);
+
+    state.get(lcd_control);
+    state.get(lcd_status);
+    state.get(vertical_counter);
+    state.get(bg_control);
+    state.get(bg_offset);
+    state.get(bg2_rot_scale);
+    state.get(bg3_rot_scale);
+    state.get(win0_top_left);
+    state.get(win0_bot_right);
+    state.get(win1_top_left);
+    state.get(win1_bot_right);
+    state.get(win0);
+    state.get(win1);
+    state.get(win_out);
+    state.get(win_obj);
+    state.get(mosaic_size);
+    state.get(blend_control);
+    state.get(alpha_coeff);
+    state.get(brightness_coeff);
+
+    state.get_memory(pram.data());
+    state.get_memory(vram.data());
+    state.get_memory(oam.data());
+
+    /* everything worked out from memory and registers goes, the writes that
+     * would have kept it up to date never happened */
+    for (uint32_t address = 0; address < PRAM_SIZE; address += 4) {
+        pram_written(address);
     }
 
-    return color_index;
+    tiles.invalidate_all();
+    objects_dirty = true;
+    update_layers();
+
+    for (auto& generation : vram_generation) {
+        generation++;
+    }
+    oam_generation++;
+
+    for (auto& inputs : drawn_inputs) {
+        inputs.format = UINT32_MAX;
+    }
 }
 
+// if 16th bit is set, this will denote the transparent color in rgb555 format
     int read = false;
 Color
 Display::fetch_color(uint32_t index, uint8_t bank, bool obj) {
@@ -397,8 +727,7 @@ Display::fetch_color(uint32_t index, uint8_t bank, bool obj) {
         return Color(TRANSPARENT_RGB555);
     }
 
-    uint32_t palette_addr = 2 * index + 0x20 * bank + (obj ? 0x200 : 0);
-    return Color(pram.read_halfword(palette_addr) & 0x7FFF);
+    return Color(palette[index + 16 * bank + (obj ? 256 : 0)]);
 }
 }
 }
@@ -0,0 +1,92 @@
+#include "io/display/frame_sink.hh"
+#include "util/log.hh"
+#include <ios>
+
+namespace matar {
+namespace display {
+RawFileSink::RawFileSink(const std::string& path)
+  : file(std::fopen(path.c_str(), "wb")) {
+    if (file == nullptr) {
+        throw std::ios::failure("Could not open " + path, std::error_code());
+    }
+}
+
+RawFileSink::~RawFileSink() {
+    std::fclose(file);
+}
+
+void
+RawFileSink::consume(const Frame& frame) {
+    if (std::fwrite(frame.pixels.data(), 1, frame.pixels.size(), file) !=
+        frame.pixels.size()) {
+        glogger.error("Failed to write frame {}", frame.number);
+    }
+}
+
+TripleBuffer::TripleBuffer()
+  : buffers(
+      std::make_unique<std::array<std::array<uint8_t, FRAME_SIZE>, 3>>()) {}
+
+void
+TripleBuffer::publish(PixelFormat format, uint64_t number) {
+    const uint32_t pitch = LCD_WIDTH * bytes_per_pixel(format);
+
+    frames[back_index] = Frame{
+        .pixels = { (*buffers)[back_index].data(), pitch * LCD_HEIGHT },
+        .format = format,
+        .width  = LCD_WIDTH,
+        .height = LCD_HEIGHT,
+        .pitch  = pitch,
+        .number = number,
+    };
+
+    uint8_t previous = middle.exchange(back_index | FRESH);
+
+    if (previous & FRESH) {
+        drops.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    back_index = previous & ~FRESH;
+}
+
+const Frame*
+TripleBuffer::acquire() {
+    if (!(middle.load() & FRESH)) {
+        return nullptr;
+    }
+
+    front_index = middle.exchange(front_index) & ~FRESH;
+    return &frames[front_index];
+}
+
+SinkThread::SinkThread(TripleBuffer& buffers, FrameSink& sink)
+  : buffers(buffers)
+  , sink(sink)
+  , thread(&SinkThread::run, this) {}
+
+SinkThread::~SinkThread() {
+    stopping = true;
+    notify();
+    thread.join();
+}
+
+void
+SinkThread::run() {
+    uint64_t seen = 0;
+
+    while (true) {
+        wakeups.wait(seen);
+        seen = wakeups.load();
+
+        while (const Frame* frame = buffers.acquire()) {
+            sink.consume(*frame);
+        }
+
+        /* the last frame is still handed over before stopping */
+        if (stopping) {
+            break;
+        }
+    }
+}
+}
+}
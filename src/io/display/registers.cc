@@ -110,6 +110,7 @@ Display::write_halfword(uint32_t address, uint16_t halfword) {
     switch (address) {
         case DISPCNT: {
             lcd_control.write(halfword);
+            update_layers();
             break;
         }
         case DISPSTAT: {
@@ -118,18 +119,22 @@ Display::write_halfword(uint32_t address, uint16_t halfword) {
         }
         case BG0CNT: {
             bg_control[0].write(halfword);
+            update_layers();
             break;
         }
         case BG1CNT: {
             bg_control[1].write(halfword);
+            update_layers();
             break;
         }
         case BG2CNT: {
             bg_control[2].write(halfword);
+            update_layers();
             break;
         }
         case BG3CNT: {
             bg_control[3].write(halfword);
+            update_layers();
             break;
         }
         case BG0HOFS: {
@@ -272,16 +277,19 @@ Display::write_halfword(uint32_t address, uint16_t halfword) {
             win1.write(bit_range(halfword, 8, 15));
             win0.write(bit_range(halfword, 0, 7));
             glogger.debug("writing winin {:b}", halfword);
+            update_layers();
             break;
         }
         case WINOUT: {
             win_obj.write(bit_range(halfword, 8, 15));
             win_out.write(bit_range(halfword, 0, 7));
             glogger.debug("writing winout {:b}", halfword);
+            update_layers();
             break;
         }
         case BLDCNT: {
             blend_control.write(halfword);
+            update_layers();
             break;
         }
         case BLDALPHA: {
@@ -1,7 +1,10 @@
+#include "io/display/affine.hh"
 #include "io/display/display.hh"
 #include "io/display/registers.hh"
 #include "util/bits.hh"
 #include "util/log.hh"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 namespace matar {
@@ -21,34 +24,84 @@ pixel_to_texel(Vec2<Int> ref, Int x, Int a, Int c) {
 template<int MODE, typename>
 void
 Display::render_bitmap_mode_line() {
-    static constexpr uint32_t VIEWPORT_WIDTH = MODE == 5 ? 160 : LCD_WIDTH;
+    static constexpr int32_t VIEWPORT_WIDTH  = MODE == 5 ? 160 : LCD_WIDTH;
+    static constexpr int32_t VIEWPORT_HEIGHT = MODE == 5 ? 128 : LCD_HEIGHT;
     static constexpr uint32_t FRAME_1_OFFSET = 0xA000;
+    /* mode 3 and 5 takes 2 bytes per pixel */
+    static constexpr uint32_t PIXEL_SIZE = MODE == 4 ? 1 : 2;
+
+    const RotationScaling& rot_scale = bg2_rot_scale;
+    auto& line                       = scanline_buffers[2];
+
+    uint32_t frame_offset = 0;
+
+    if constexpr (MODE != 3) {
+        if (lcd_control.value.frame_select_1) {
+            frame_offset = FRAME_1_OFFSET;
+        }
+    }
+
+    /* no rotation or scaling, the line is a run of one row of the bitmap */
+    if (rot_scale.a == 0x100 && rot_scale.c == 0) {
+        const int32_t texel_x = rot_scale.internal.x >> 8;
+        const int32_t texel_y = rot_scale.internal.y >> 8;
+
+        /* part of the line that falls inside the bitmap */
+        int32_t begin = 0, end = 0;
+
+        if (texel_y >= 0 && texel_y < VIEWPORT_HEIGHT) {
+            begin = std::clamp(-texel_x, 0, LCD_WIDTH);
+            end   = std::clamp(VIEWPORT_WIDTH - texel_x, begin, LCD_WIDTH);
+        }
+
+        std::fill(line.begin(), line.begin() + begin, TRANSPARENT_RGB555);
+        std::fill(line.begin() + end, line.end(), TRANSPARENT_RGB555);
+
+        if (begin == end) {
+            return;
+        }
+
+        const uint8_t* row =
+          vram.data().data() + frame_offset +
+          (texel_y * VIEWPORT_WIDTH + texel_x + begin) * PIXEL_SIZE;
+
+        if constexpr (MODE == 4) {
+            for (int32_t x = begin; x < end; x++) {
+                const uint8_t index = row[x - begin];
+                line[x] = index == 0 ? TRANSPARENT_RGB555 : palette[index];
+            }
+        } else {
+            std::memcpy(&line[begin], row, (end - begin) * PIXEL_SIZE);
+
+            for (int32_t x = begin; x < end; x++) {
+                line[x] &= 0x7FFF;
+            }
+        }
+
+        return;
+    }
 
     for (auto x = 0; x < LCD_WIDTH; x++) {
         /* pixel to texel for x shift by 8 cuz both ref.x and a are fixed point
          * floats shifted by 8 terms with b and d are ignored cuz they are
          * already added at vblank to internal x and y */
         Vec2<int32_t> texel = pixel_to_texel<int32_t>(
-          bg2_rot_scale.internal, x, bg2_rot_scale.a, bg2_rot_scale.c);
-
-        uint32_t idx = texel.y * VIEWPORT_WIDTH + texel.x;
+          rot_scale.internal, x, rot_scale.a, rot_scale.c);
 
-        /* mode 3 and 5 takes 2 bytes per pixel */
-        if constexpr (MODE != 4) {
-            idx *= 2;
+        /* bitmaps do not wrap around */
+        if (texel.x < 0 || texel.x >= VIEWPORT_WIDTH || texel.y < 0 ||
+            texel.y >= VIEWPORT_HEIGHT) {
+            line[x] = TRANSPARENT_RGB555;
+            continue;
         }
 
-        /* offset */
-        if constexpr (MODE != 3) {
-            if (lcd_control.value.frame_select_1) {
-                idx += FRAME_1_OFFSET;
-            }
-        }
-        /* read two bytes */
+        uint32_t idx =
+          frame_offset + (texel.y * VIEWPORT_WIDTH + texel.x) * PIXEL_SIZE;
+
         if constexpr (MODE == 4) {
-            scanline_buffers[2][x] = fetch_color(vram.read_byte(idx), 0, 0);
+            line[x] = fetch_color(vram.read_byte(idx), 0, 0).raw();
         } else {
-            scanline_buffers[2][x] = vram.read_halfword(idx);
+            line[x] = vram.read_halfword(idx) & 0x7FFF;
         }
     }
 }
@@ -151,16 +204,17 @@ Display::render_text_layer_line() {
                                  *  8bit depth -> 64 bytes per tile */
                                 + map.tile_number * tile_data_size;
 
-        while (pixel_in_tile.x < TILE_SIZE && x < LCD_WIDTH) {
-
-            const uint8_t color_index = read_color_index(
-              tile_address,
-              map.mirrorx ? TILE_SIZE - 1 - pixel_in_tile.x : pixel_in_tile.x,
-              map.mirrory ? TILE_SIZE - 1 - pixel_in_tile.y : pixel_in_tile.y,
-              static_cast<ColorDepth>(color_256));
+        /* the cache already holds horizontally flipped tiles */
+        const uint8_t* row = tiles.row(
+          tile_address,
+          static_cast<ColorDepth>(color_256),
+          map.mirrorx,
+          map.mirrory ? TILE_SIZE - 1 - pixel_in_tile.y : pixel_in_tile.y);
+        const uint8_t bank = color_256 ? 0 : map.palette_number;
 
+        while (pixel_in_tile.x < TILE_SIZE && x < LCD_WIDTH) {
             scanline_buffers[LAYER][x] =
-              fetch_color(color_index, color_256 ? 0 : map.palette_number, 0);
+              fetch_color(row[pixel_in_tile.x], bank, 0).raw();
 
             pixel_in_tile.x++;
             x++;
@@ -192,55 +246,23 @@ Display::render_text_layer_line<3>();
 template<int LAYER, typename>
 void
 Display::render_rot_scale_layer_line() {
-    constexpr auto TILE_SIZE = 8;
-
-    uint32_t tile_base =
-      bg_control[LAYER].value.character_base_block * TILE_BLOCK_SIZE;
-    uint32_t map_base =
-      bg_control[LAYER].value.screen_base_block * SCREEN_BLOCK_SIZE;
-    int32_t screen_size = 128 << bg_control[LAYER].value.screen_size;
-
+    const auto& control = bg_control[LAYER].value;
     const RotationScaling& rot_scale =
       LAYER == 2 ? bg2_rot_scale : bg3_rot_scale;
 
-    for (int x = 0; x < LCD_WIDTH; x++) {
-        /* pixel to texel for x shift by 8 cuz both ref.x and a are fixed point
-         * floats shifted by 8 */
-        Vec2<int32_t> texel = pixel_to_texel<int32_t>(
-          rot_scale.internal, x, rot_scale.a, rot_scale.c);
-
-        /* area overflow */
-        if (texel.x < 0 || texel.x >= screen_size || texel.y < 0 ||
-            texel.y >= screen_size) {
-            if (bg_control[LAYER].value.bg_2_3_wraparound) {
-                texel.x &= screen_size - 1;
-                texel.y &= screen_size - 1;
-            } else {
-                scanline_buffers[LAYER][x] = fetch_color(0, 0, 0);
-                continue;
-            }
-        }
-
-        Vec2<uint32_t> tile_pos = {
-            static_cast<uint32_t>(texel.x) / TILE_SIZE,
-            static_cast<uint32_t>(texel.y) / TILE_SIZE,
-        };
-
-        auto n_tiles = screen_size / TILE_SIZE;
-
-        auto map_address = map_base + (tile_pos.x + tile_pos.y * n_tiles);
-
-        auto tile_address = tile_base + (uint32_t)vram.read_byte(map_address)
-                                          /* only supports 8 bit depth */
-                                          * TILE_SIZE_8BIT_DEPTH;
-
-        uint8_t color_index = read_color_index(tile_address,
-                                               texel.x % TILE_SIZE,
-                                               texel.y % TILE_SIZE,
-                                               ColorDepth::BPP8);
-
-        scanline_buffers[LAYER][x] = fetch_color(color_index, 0, 0);
-    }
+    /* b and d are already added to the internal reference point every line */
+    sample_affine_background(
+      AffineBackground{
+        .vram       = vram.data().data(),
+        .palette    = palette.data(),
+        .tile_base  = control.character_base_block * TILE_BLOCK_SIZE,
+        .map_base   = control.screen_base_block * SCREEN_BLOCK_SIZE,
+        .size       = 128 << control.screen_size,
+        .wraparound = control.bg_2_3_wraparound,
+        .origin     = rot_scale.internal,
+        .step       = { rot_scale.a, rot_scale.c },
+      },
+      scanline_buffers[LAYER]);
 }
 
 // explicit instantitation
@@ -305,30 +327,23 @@ Display::read_rotation_params(const OamAttributes& o) {
     return params;
 }
 
-void
-Display::render_one_object(int idx) {
-    OamAttributes o    = read_oam_attributes(idx);
-    uint32_t tile_base = OBJ_START_TEXT_MODE + o.attr2.number * OBJ_TILE_SIZE;
-    ObjectMode mode    = static_cast<ObjectMode>(o.attr0.mode);
-    Vec2<int32_t> size = object_size(o);
-    Vec2<int32_t> display_size = size;
-    Vec2<int32_t> obj_pos      = { o.attr1.x, o.attr0.y };
-    RotationParams rot_params;
+inline bool
+Display::object_bounds(const OamAttributes& o,
+                       Vec2<int32_t>& pos,
+                       Vec2<int32_t>& display_size) {
+    display_size = object_size(o);
+    pos          = { o.attr1.x, o.attr0.y };
 
-    if (obj_pos.x >= LCD_WIDTH)
-        obj_pos.x -= 512;
-    if (obj_pos.y >= LCD_HEIGHT)
-        obj_pos.y -= 256;
+    if (pos.x >= LCD_WIDTH)
+        pos.x -= 512;
+    if (pos.y >= LCD_HEIGHT)
+        pos.y -= 256;
 
-    const auto y = vertical_counter;
-
-    if (mode == ObjectMode::Prohibited) {
-        return;
+    if (o.attr0.mode == ObjectMode::Prohibited) {
+        return false;
     }
 
     if (o.attr0.rot_scale_flag) {
-        rot_params = read_rotation_params(o);
-
         if (o.attr0.double_size_or_obj_disable) {
             /* double size */
             display_size.x *= 2;
@@ -337,52 +352,108 @@ Display::render_one_object(int idx) {
     } else {
         if (o.attr0.double_size_or_obj_disable) {
             /* OBJ disable */
-            return;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+Display::scan_objects() {
+    line_object_count.fill(0);
+
+    for (int i = 0; i < N_OBJECTS; i++) {
+        OamAttributes o = read_oam_attributes(i);
+        Vec2<int32_t> pos, display_size;
+
+        if (!object_bounds(o, pos, display_size)) {
+            continue;
+        }
+
+        int top    = std::max(pos.y, 0);
+        int bottom = std::min(pos.y + display_size.y, LCD_HEIGHT);
+
+        for (int y = top; y < bottom; y++) {
+            line_objects[y][line_object_count[y]++] = i;
         }
     }
 
-    /* continue if object does not cover current scanline */
-    if (y < obj_pos.y || y >= obj_pos.y + display_size.y) {
+    objects_dirty = false;
+}
+
+void
+Display::render_one_object(int idx) {
+    OamAttributes o    = read_oam_attributes(idx);
+    uint32_t tile_base = OBJ_START_TEXT_MODE + o.attr2.number * OBJ_TILE_SIZE;
+    ObjectMode mode    = static_cast<ObjectMode>(o.attr0.mode);
+    Vec2<int32_t> size = object_size(o);
+    Vec2<int32_t> display_size;
+    Vec2<int32_t> obj_pos;
+    RotationParams rot_params;
+
+    const auto y = vertical_counter;
+
+    if (!object_bounds(o, obj_pos, display_size)) {
         return;
     }
 
+    if (o.attr0.rot_scale_flag) {
+        rot_params = read_rotation_params(o);
+    }
+
     /* ignore for bg mode 3-5 for numbers 0-511 */
     if (lcd_control.value.mode > 2 && o.attr2.number < 512) {
         return;
     }
 
-    for (int x = obj_pos.x; x < obj_pos.x + display_size.x && x < LCD_WIDTH;
-         x++) {
-        if (x < 0) {
-            continue;
-        }
+    const int begin = std::max(obj_pos.x, 0);
+    const int end   = std::min(obj_pos.x + display_size.x, LCD_WIDTH);
 
-        if (object_buffer[x][y].priority <= o.attr2.priority &&
-            o.attr0.mode != ObjectMode::Window) {
-            continue;
-        }
+    if (begin >= end) {
+        return;
+    }
+
+    static constexpr auto TILE_SIZE     = 8;
+    static constexpr auto VRAM_ROW_SIZE = 1024;
+
+    const uint8_t tile_size =
+      o.attr0.colors256 ? TILE_SIZE_8BIT_DEPTH : TILE_SIZE_4BIT_DEPTH;
+    const uint8_t bank = o.attr0.colors256 ? 0 : o.attr2.palette;
+
+    const uint32_t tiles_in_one_row = lcd_control.value.obj_vram_1d_mapping
+                                        ? size.x / 8
+                                        : VRAM_ROW_SIZE / tile_size;
+
+    /* colors of the pixels from begin to end */
+    std::array<u16, LCD_WIDTH> colors;
+
+    if (o.attr0.rot_scale_flag) {
+        /* if rotation/scaling is on */
+        Vec2<int32_t> ref{
+            begin - obj_pos.x - display_size.x / 2,
+            y - obj_pos.y - display_size.y / 2,
+        };
+
+        sample_affine_object(
+          AffineObject{
+            .vram           = vram.data().data(),
+            .vram_size      = VRAM_SIZE,
+            .palette        = palette.data(),
+            .palette_offset = 256 + bank * 16u,
+            .tile_base      = tile_base,
+            .tiles_per_row  = tiles_in_one_row,
+            .colors256      = o.attr0.colors256,
+            .size           = size,
+            .origin = { rot_params.a * ref.x + rot_params.b * ref.y,
+                        rot_params.c * ref.x + rot_params.d * ref.y },
+            .step   = { rot_params.a, rot_params.c },
+          },
+          std::span(colors).first(end - begin));
+    } else {
+        for (int x = begin; x < end; x++) {
+            Vec2<int32_t> tile_pos = { x - obj_pos.x, y - obj_pos.y };
 
-        Vec2<int32_t> tile_pos;
-
-        if (o.attr0.rot_scale_flag) {
-            /* if rotation/scaling is on */
-            Vec2<int32_t> ref{
-                x - obj_pos.x - display_size.x / 2,
-                y - obj_pos.y - display_size.y / 2,
-            };
-
-            tile_pos = {
-                ((rot_params.a * ref.x + rot_params.b * ref.y) >> 8) +
-                  size.x / 2,
-                ((rot_params.c * ref.x + rot_params.d * ref.y) >> 8) +
-                  size.y / 2,
-            };
-            if (tile_pos.x < 0 || tile_pos.x >= size.x || tile_pos.y < 0 ||
-                tile_pos.y >= size.y) {
-                continue;
-            }
-        } else {
-            tile_pos = { x - obj_pos.x, y - obj_pos.y };
             /* horizontal flip */
             if (get_bit(o.attr1.trans_params, 3)) {
                 tile_pos.x = size.x - 1 - tile_pos.x;
@@ -391,52 +462,55 @@ Display::render_one_object(int idx) {
             if (get_bit(o.attr1.trans_params, 4)) {
                 tile_pos.y = size.y - 1 - tile_pos.y;
             }
-        }
-
-        static constexpr auto TILE_SIZE     = 8;
-        static constexpr auto VRAM_ROW_SIZE = 1024;
 
-        uint8_t tile_size =
-          o.attr0.colors256 ? TILE_SIZE_8BIT_DEPTH : TILE_SIZE_4BIT_DEPTH;
+            uint32_t tile_address =
+              tile_base +
+              tile_size * (tile_pos.x / TILE_SIZE +
+                           (tile_pos.y / TILE_SIZE) * tiles_in_one_row);
 
-        size_t tiles_in_one_row = lcd_control.value.obj_vram_1d_mapping
-                                    ? size.x / 8
-                                    : VRAM_ROW_SIZE / tile_size;
+            uint8_t color_index =
+              tiles.row(tile_address,
+                        static_cast<ColorDepth>(o.attr0.colors256),
+                        false,
+                        tile_pos.y % TILE_SIZE)[tile_pos.x % TILE_SIZE];
 
-        size_t tile_address =
-          tile_base + tile_size * (tile_pos.x / TILE_SIZE +
-                                   (tile_pos.y / TILE_SIZE) * tiles_in_one_row);
+            colors[x - begin] = fetch_color(color_index, bank, 1).raw();
+        }
+    }
 
-        uint8_t color_index =
-          read_color_index(tile_address,
-                           tile_pos.x % 8,
-                           tile_pos.y % 8,
-                           static_cast<ColorDepth>(o.attr0.colors256));
+    for (int x = begin; x < end; x++) {
+        if (object_buffer[x].priority <= o.attr2.priority &&
+            o.attr0.mode != ObjectMode::Window) {
+            continue;
+        }
 
-        Color color = fetch_color(
-          color_index, (o.attr0.colors256 ? 0 : o.attr2.palette), 1);
+        const u16 color = colors[x - begin];
 
-        if (color.raw() == TRANSPARENT_RGB555) {
+        if (color == TRANSPARENT_RGB555) {
             continue;
         }
 
         if (mode == ObjectMode::Window) {
-            object_buffer[x][y].is_window = true;
+            object_buffer[x].is_window = true;
             continue;
         }
 
-        object_buffer[x][y].color    = color;
-        object_buffer[x][y].priority = o.attr2.priority;
-        object_buffer[x][y].is_alpha = mode == ObjectMode::Alpha;
+        object_buffer[x].color    = Color(color);
+        object_buffer[x].priority = o.attr2.priority;
+        object_buffer[x].is_alpha = mode == ObjectMode::Alpha;
     }
 }
 
 void
 Display::render_objects_line() {
-    static constexpr auto N_OBJECTS = 128;
+    if (objects_dirty) {
+        scan_objects();
+    }
 
-    for (int i = 0; i < N_OBJECTS; i++) {
-        render_one_object(i);
+    const auto y = vertical_counter;
+
+    for (int i = 0; i < line_object_count[y]; i++) {
+        render_one_object(line_objects[y][i]);
     }
 }
 }
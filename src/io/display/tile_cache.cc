@@ -0,0 +1,36 @@
+#include "io/display/tile_cache.hh"
+
+namespace matar {
+namespace display {
+TileCache::TileCache(std::span<const uint8_t> vram)
+  : vram(vram)
+  , slots(vram.size() / SLOT_SIZE)
+  , tiles4(new DecodedTile[slots])
+  , tiles8(new DecodedTile[slots])
+  , valid(slots, 0) {}
+
+void
+TileCache::decode(uint32_t slot, ColorDepth depth) {
+    DecodedTile& tile =
+      depth == ColorDepth::BPP8 ? tiles8[slot] : tiles4[slot];
+    const uint32_t address = slot * SLOT_SIZE;
+
+    for (uint32_t i = 0; i < TILE_PIXELS; i++) {
+        uint8_t color_index;
+
+        if (depth == ColorDepth::BPP4) {
+            color_index = vram[address + i / 2];
+            color_index = i & 1 ? color_index >> 4 : color_index & 0xF;
+        } else {
+            /* the last tile of VRAM runs past its end */
+            color_index = address + i < vram.size() ? vram[address + i] : 0;
+        }
+
+        uint32_t x = i % TILE_SIZE;
+
+        tile[i]                                       = color_index;
+        tile[TILE_PIXELS + i - x + TILE_SIZE - 1 - x] = color_index;
+    }
+}
+}
+}
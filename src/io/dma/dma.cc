@@ -1,7 +1,8 @@
 #include "bus.hh"
 #include "scheduler.hh"
-#include "util/log.hh"
 #include <algorithm>
+#include <stdexcept>
+#include <string>
 
 namespace matar {
 /* lookup */
@@ -75,8 +76,11 @@ Dma::start_transfer(uint8_t id) {
             break;
         }
         default: {
-            glogger.error("this is NOT supposed to happen");
-            std::abort();
+            /* thrown rather than aborted on, a ROM that does this only
+             * fails whoever is running it */
+            throw std::runtime_error("DMA" + std::to_string(id) +
+                                     " source address control 3 is "
+                                     "prohibited");
         }
     }
 
@@ -98,8 +102,7 @@ Dma::start_transfer(uint8_t id) {
             break;
         }
         default: {
-            glogger.error("this is NOT supposed to happen");
-            std::abort();
+            throw std::logic_error("this is NOT supposed to happen");
         }
     }
 
@@ -173,4 +176,26 @@ Dma::schedule_sound_xfer(uint32_t fifo_addr, uint64_t at) {
         }
     }
 }
+
+void
+Dma::save(StateWriter& state) const {
+    for (const auto& chan : channels) {
+        state.put(chan.timestamp);
+        state.put(chan.source);
+        state.put(chan.destination);
+        state.put(chan.word_count);
+        state.put(chan.control.read());
+    }
+}
+
+void
+Dma::load(StateReader& state) {
+    for (auto& chan : channels) {
+        state.get(chan.timestamp);
+        state.get(chan.source);
+        state.get(chan.destination);
+        state.get(chan.word_count);
+        chan.control.write(state.get<u16>());
+    }
+}
 }
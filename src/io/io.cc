@@ -114,6 +114,7 @@ IoDevices::read_halfword(uint32_t address) const {
         case 0x100: {
             return timer.read_halfword(address);
         }
+        case 0x130:
         case 0x200:
         case 0x300: {
             return system.read_halfword(address);
@@ -143,7 +144,13 @@ IoDevices::write_halfword(uint32_t address, uint16_t halfword) {
         case 0x080:
         case 0x090:
         case 0x0A0: {
+            uint8_t fifo_timers = sound.fifo_timers();
+
             sound.write_halfword(address, halfword);
+
+            if (sound.fifo_timers() != fifo_timers) {
+                timer.reschedule();
+            }
             break;
         }
         case 0x0B0:
@@ -157,6 +164,7 @@ IoDevices::write_halfword(uint32_t address, uint16_t halfword) {
             timer.write_halfword(address, halfword);
             break;
         }
+        case 0x130:
         case 0x200:
         case 0x300: {
             system.write_halfword(address, halfword);
@@ -168,4 +176,22 @@ IoDevices::write_halfword(uint32_t address, uint16_t halfword) {
         }
     }
 }
+
+void
+IoDevices::save(StateWriter& state) const {
+    display.save(state);
+    sound.save(state);
+    dma.save(state);
+    timer.save(state);
+    system.save(state);
+}
+
+void
+IoDevices::load(StateReader& state) {
+    display.load(state);
+    sound.load(state);
+    dma.load(state);
+    timer.load(state);
+    system.load(state);
+}
 }
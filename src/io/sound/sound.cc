@@ -1,5 +1,6 @@
 #include "io/sound/sound.hh"
 #include "io/sound/buffer.hh"
+#include "util/hash.hh"
 #include "util/log.hh"
 #include <algorithm>
 
@@ -28,8 +29,25 @@ Sound::dma_playback(uint8_t timer_id, uint64_t at) {
     }
 }
 
+void
+Sound::set_output(bool enable) {
+    output = enable;
+
+    if (output && !sampling) {
+        sampling = true;
+        scheduler.schedule_from_now(Task::Type::SAMPLE_PWM,
+                                    PWM_FREQUENCY / sampling_rate);
+    }
+}
+
 void
 Sound::sample(uint64_t at) {
+    /* stop sampling until output is enabled again */
+    if (!output) {
+        sampling = false;
+        return;
+    }
+
     Sample<float> sample;
     int bias = sound_bias.value.level << 1;
 
@@ -64,11 +82,85 @@ Sound::sample(uint64_t at) {
         sample.right = static_cast<float>(apply_bias(right));
     }
 
+    /* the samples are still whole numbers here */
+    if (hash_samples) {
+        const auto left  = static_cast<int32_t>(sample.left);
+        const auto right = static_cast<int32_t>(sample.right);
+
+        sample_hash = hash::combine(sample_hash,
+                                    static_cast<uint32_t>(left) |
+                                      static_cast<uint64_t>(right) << 32);
+    }
+
 
     resampler.resample(sample, buffer);
 
     scheduler.schedule_at(Task::Type::SAMPLE_PWM,
                           at + (PWM_FREQUENCY / sampling_rate));
 }
+
+void
+Sound::save(StateWriter& state) const {
+    state.put(ch1_sweep);
+    state.put(ch1_envelope);
+    state.put(ch1_freq_ctrl);
+    state.put(ch2_envelope);
+    state.put(ch2_freq_ctrl);
+    state.put(ch3_wave_select);
+    state.put(ch3_len_vol);
+    state.put(ch3_freq_ctrl);
+    state.put(ch3_wave_pattern);
+    state.put(ch4_envelope);
+    state.put(ch4_freq_ctrl);
+    state.put(vol_ctrl);
+    state.put(dma_ctrl);
+    state.put(sound_on_off);
+    state.put(sound_bias);
+
+    fifo_a.save(state);
+    fifo_b.save(state);
+
+    state.put(dma_value_a);
+    state.put(dma_value_b);
+    state.put(sampling_rate);
+    resampler.save(state);
+}
+
+void
+Sound::load(StateReader& state) {
+    state.get(ch1_sweep);
+    state.get(ch1_envelope);
+    state.get(ch1_freq_ctrl);
+    state.get(ch2_envelope);
+    state.get(ch2_freq_ctrl);
+    state.get(ch3_wave_select);
+    state.get(ch3_len_vol);
+    state.get(ch3_freq_ctrl);
+    state.get(ch3_wave_pattern);
+    state.get(ch4_envelope);
+    state.get(ch4_freq_ctrl);
+    state.get(vol_ctrl);
+    state.get(dma_ctrl);
+    state.get(sound_on_off);
+    state.get(sound_bias);
+
+    fifo_a.load(state);
+    fifo_b.load(state);
+
+    state.get(dma_value_a);
+    state.get(dma_value_b);
+    state.get(sampling_rate);
+    resampler.load(state);
+
+    /* whether sampling was stopped depends on the output of the machine
+     * that saved the state, the queue says whether a sample is coming */
+    const auto tasks = scheduler.pending();
+
+    sampling = std::any_of(tasks.begin(), tasks.end(), [](const Task& task) {
+        return task.type == Task::Type::SAMPLE_PWM;
+    });
+
+    set_output(output);
+}
 }
 }
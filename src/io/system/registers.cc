@@ -2,17 +2,26 @@
 #include "util/log.hh"
 
 namespace matar {
-static constexpr uint32_t IE      = 0x4000200;
-static constexpr uint32_t IF      = 0x4000202;
-static constexpr uint32_t WAITCNT = 0x4000204;
-static constexpr uint32_t IME     = 0x4000208;
-static constexpr uint32_t POSTFLG = 0x4000300;
-static constexpr uint32_t HALTCNT = 0x4000301;
+static constexpr uint32_t KEYINPUT = 0x4000130;
+static constexpr uint32_t KEYCNT   = 0x4000132;
+static constexpr uint32_t IE       = 0x4000200;
+static constexpr uint32_t IF       = 0x4000202;
+static constexpr uint32_t WAITCNT  = 0x4000204;
+static constexpr uint32_t IME      = 0x4000208;
+static constexpr uint32_t POSTFLG  = 0x4000300;
+static constexpr uint32_t HALTCNT  = 0x4000301;
 
 uint16_t
 System::read_halfword(uint32_t address) const {
 
     switch (address) {
+        case KEYINPUT: {
+            /* released keys read as set */
+            return ~keys_pressed & 0x3FF;
+        }
+        case KEYCNT: {
+            return key_control;
+        }
         case IE: {
             return interrupt_enable;
         }
@@ -44,6 +53,13 @@ System::read_halfword(uint32_t address) const {
 void
 System::write_halfword(uint32_t address, uint16_t halfword) {
     switch (address) {
+        case KEYINPUT: {
+            break;
+        }
+        case KEYCNT: {
+            key_control = halfword;
+            break;
+        }
         case IE: {
             interrupt_enable = halfword;
             break;
@@ -76,4 +92,46 @@ System::write_halfword(uint32_t address, uint16_t halfword) {
         }
     }
 }
+
+void
+System::set_keys(uint16_t pressed) {
+    keys_pressed = pressed & 0x3FF;
+
+    /* KEYCNT asks for an interrupt when any of the keys it selects are held,
+     * or all of them with its top bit set */
+    const uint16_t selected = key_control & 0x3FF;
+
+    if (!(key_control & 1 << 14) || selected == 0) {
+        return;
+    }
+
+    if (key_control & 1 << 15 ? (keys_pressed & selected) == selected
+                              : (keys_pressed & selected) != 0) {
+        raise_irq(Irq::KEYPAD);
+    }
+}
+
+void
+System::save(StateWriter& state) const {
+    state.put(interrupt_enable);
+    state.put(interrupt_request_flags);
+    state.put(interrupt_master_enabler);
+    state.put(post_boot_flag);
+    state.put(waitstate_control);
+    state.put(low_power_mode);
+    state.put(keys_pressed);
+    state.put(key_control);
+}
+
+void
+System::load(StateReader& state) {
+    state.get(interrupt_enable);
+    state.get(interrupt_request_flags);
+    state.get(interrupt_master_enabler);
+    state.get(post_boot_flag);
+    state.get(waitstate_control);
+    state.get(low_power_mode);
+    state.get(keys_pressed);
+    state.get(key_control);
+}
 }
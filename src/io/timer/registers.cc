@@ -17,25 +17,25 @@ Timer::read_halfword(uint32_t address) const {
 
     switch (address) {
         case TM0CNT_L: {
-            return timers[0].counter;
+            return counter(0, scheduler.get_cycles());
         }
         case TM0CNT_H: {
             return timers[0].control.read();
         }
         case TM1CNT_L: {
-            return timers[1].counter;
+            return counter(1, scheduler.get_cycles());
         }
         case TM1CNT_H: {
             return timers[1].control.read();
         }
         case TM2CNT_L: {
-            return timers[2].counter;
+            return counter(2, scheduler.get_cycles());
         }
         case TM2CNT_H: {
             return timers[2].control.read();
         }
         case TM3CNT_L: {
-            return timers[3].counter;
+            return counter(3, scheduler.get_cycles());
         }
         case TM3CNT_H: {
             return timers[3].control.read();
@@ -52,7 +52,7 @@ void
 Timer::write_halfword(uint32_t address, uint16_t halfword) {
     switch (address) {
         case TM0CNT_L: {
-            timers[0].reload = halfword;
+            write_reload(0, halfword);
             break;
         }
         case TM0CNT_H: {
@@ -60,7 +60,7 @@ Timer::write_halfword(uint32_t address, uint16_t halfword) {
             break;
         }
         case TM1CNT_L: {
-            timers[1].reload = halfword;
+            write_reload(1, halfword);
             break;
         }
         case TM1CNT_H: {
@@ -68,7 +68,7 @@ Timer::write_halfword(uint32_t address, uint16_t halfword) {
             break;
         }
         case TM2CNT_L: {
-            timers[2].reload = halfword;
+            write_reload(2, halfword);
             break;
         }
         case TM2CNT_H: {
@@ -76,7 +76,7 @@ Timer::write_halfword(uint32_t address, uint16_t halfword) {
             break;
         }
         case TM3CNT_L: {
-            timers[3].reload = halfword;
+            write_reload(3, halfword);
             break;
         }
         case TM3CNT_H: {
@@ -20,14 +20,155 @@ static constexpr System::Irq irqs[NUM_TIMERS] = {
 static constexpr uint32_t prescalers[4] = { 0, 6, 8, 10 };
 // NOLINTEND(cppcoreguidelines-avoid-c-arrays)
 
-void
-Timer::schedule_overflow(uint8_t id, uint64_t at) {
+bool
+Timer::observed(uint8_t id) const {
+    auto ctrl = timers[id].control;
+
+    if (!ctrl.value.start_stop) {
+        return false;
+    }
+
+    if (ctrl.value.irq_enable || (sound.fifo_timers() & (1 << id))) {
+        return true;
+    }
+
+    return id != 3 && cascades(id + 1) && observed(id + 1);
+}
+
+uint64_t
+Timer::ticks(uint8_t id, uint64_t now) const {
     auto& timer = timers[id];
-    auto ctrl   = timer.control;
-    auto task   = tasks[id];
 
-    auto cycles = (TIMER_MAX + 1 - timer.counter) << prescalers[ctrl.value.prescaler];
-    scheduler.schedule_at(task, at + cycles);
+    if (!timer.control.value.start_stop) {
+        return 0;
+    }
+
+    if (cascades(id)) {
+        return overflows(id - 1, now);
+    }
+
+    if (now < timer.epoch) {
+        return 0;
+    }
+
+    return (now - timer.epoch) >> prescalers[timer.control.value.prescaler];
+}
+
+uint64_t
+Timer::overflows(uint8_t id, uint64_t now) const {
+    auto& timer    = timers[id];
+    uint64_t t     = ticks(id, now);
+    uint64_t first = TIMER_MAX + 1 - timer.counter;
+
+    if (t < first) {
+        return 0;
+    }
+
+    return 1 + (t - first) / (TIMER_MAX + 1 - timer.reload);
+}
+
+uint16_t
+Timer::counter(uint8_t id, uint64_t now) const {
+    auto& timer    = timers[id];
+    uint64_t t     = ticks(id, now);
+    uint64_t first = TIMER_MAX + 1 - timer.counter;
+
+    if (t < first) {
+        return timer.counter + t;
+    }
+
+    return timer.reload + (t - first) % (TIMER_MAX + 1 - timer.reload);
+}
+
+uint64_t
+Timer::next_overflow(uint8_t id, uint64_t now) const {
+    auto& timer     = timers[id];
+    uint64_t t      = ticks(id, now);
+    uint64_t first  = TIMER_MAX + 1 - timer.counter;
+    uint64_t period = TIMER_MAX + 1 - timer.reload;
+    uint64_t remaining =
+      t < first ? first - t : period - (t - first) % period;
+
+    return timer.epoch + ((t + remaining)
+                          << prescalers[timer.control.value.prescaler]);
+}
+
+void
+Timer::latch(uint64_t now) {
+    // NOLINTBEGIN(cppcoreguidelines-avoid-c-arrays)
+    uint64_t elapsed[NUM_TIMERS];
+    uint64_t overflowed[NUM_TIMERS];
+    u16 counters[NUM_TIMERS];
+    // NOLINTEND(cppcoreguidelines-avoid-c-arrays)
+
+    // cascades read the state of the previous timer, so everything has to be
+    // computed before any of it is latched
+    for (uint8_t id = 0; id < NUM_TIMERS; id++) {
+        elapsed[id]    = ticks(id, now);
+        overflowed[id] = overflows(id, now);
+        counters[id]   = counter(id, now);
+    }
+
+    for (uint8_t id = 0; id < NUM_TIMERS; id++) {
+        auto& timer   = timers[id];
+        timer.counter = counters[id];
+
+        if (timer.control.value.start_stop && !cascades(id)) {
+            // keep the prescaler phase
+            timer.epoch += elapsed[id]
+                           << prescalers[timer.control.value.prescaler];
+        } else {
+            timer.epoch = now;
+        }
+
+        if (overflowed[id] == 0) {
+            continue;
+        }
+
+        if (timer.control.value.irq_enable) {
+            irq.raise_irq(irqs[id]);
+        }
+
+        if (id <= 1) {
+            sound.dma_playback(id, now);
+        }
+    }
+}
+
+void
+Timer::reschedule() {
+    reschedule(scheduler.get_cycles());
+}
+
+void
+Timer::reschedule(uint64_t now) {
+    for (uint8_t id = 0; id < NUM_TIMERS; id++) {
+        auto& timer = timers[id];
+
+        // a cascading timer overflows along with the previous one, which is
+        // then observed as well
+        uint64_t next =
+          observed(id) && !cascades(id) ? next_overflow(id, now) : NONE;
+
+        if (next == timer.scheduled) {
+            continue;
+        }
+
+        timer.scheduled = next;
+
+        if (next != NONE) {
+            scheduler.schedule_at(tasks[id], next);
+        }
+    }
+}
+
+void
+Timer::write_reload(uint8_t id, uint16_t raw) {
+    uint64_t now = scheduler.get_cycles();
+
+    latch(now);
+    timers[id].reload = raw;
+    reschedule(now);
 }
 
 void
@@ -35,51 +176,52 @@ Timer::write_and_eval_ctrl(uint8_t id, uint16_t raw) {
     auto& timer      = timers[id];
     auto& ctrl       = timer.control;
     bool was_enabled = ctrl.value.start_stop;
+    uint64_t now     = scheduler.get_cycles();
 
+    latch(now);
     ctrl.write(raw);
 
-    if (ctrl.value.start_stop == true) {
-        if (was_enabled == false) {
-            timer.counter = timer.reload;
-        }
-
-        if (!ctrl.value.count_up) {
-            schedule_overflow(id, scheduler.get_cycles());
-        }
-    } else {
+    if (ctrl.value.start_stop && !was_enabled) {
+        timer.counter = timer.reload;
     }
+
+    timer.epoch = now;
+    reschedule(now);
 };
 
 void
 Timer::trigger_overflow(uint8_t id, uint64_t at) {
     auto& timer = timers[id];
-    auto ctrl  = timer.control;
 
-    if (!timer.control.value.start_stop) {
+    // superseded by a register write since it was scheduled
+    if (at != timer.scheduled) {
         return;
     }
 
-    timer.counter = timer.reload;
-
-    if (ctrl.value.irq_enable) {
-        irq.raise_irq(irqs[id]);
-    }
+    timer.scheduled = NONE;
+    latch(at);
+    reschedule(at);
+}
 
-    if (id != 3) {
-        auto& next = timers[id + 1];
-        if (next.control.value.count_up) {
-            if (next.counter == TIMER_MAX) {
-                trigger_overflow(id + 1, at);
-            } else {
-                next.counter++;
-            }
-        }
+void
+Timer::save(StateWriter& state) const {
+    for (const auto& timer : timers) {
+        state.put(timer.counter);
+        state.put(timer.reload);
+        state.put(timer.control.read());
+        state.put(timer.epoch);
+        state.put(timer.scheduled);
     }
+}
 
-    if (id <= 1) {
-        sound.dma_playback(id, at);
+void
+Timer::load(StateReader& state) {
+    for (auto& timer : timers) {
+        state.get(timer.counter);
+        state.get(timer.reload);
+        timer.control.write(state.get<u16>());
+        state.get(timer.epoch);
+        state.get(timer.scheduled);
     }
-
-    schedule_overflow(id, at);
 }
 }
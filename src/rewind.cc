@@ -0,0 +1,256 @@
+#include "rewind.hh"
+#include "savestate.hh"
+#include "util/spsc.hh"
+#include "util/state.hh"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace matar {
+// Deltas start with the size of the older state, followed by runs of
+// unchanged bytes, skipped, and of changed ones, XORed in. Each run is a
+// count of unchanged bytes then one of changed bytes, as varints, then the
+// changed bytes. Short stretches of unchanged bytes are kept in with the
+// changed ones, a run costs more than that.
+static constexpr size_t SHORTEST_SKIP = 8;
+
+static void
+put_varint(StateWriter& delta, size_t value) {
+    while (value >= 0x80) {
+        delta.put<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+
+    delta.put<uint8_t>(value);
+}
+
+static size_t
+get_varint(StateReader& delta) {
+    size_t value = 0;
+
+    for (int shift = 0;; shift += 7) {
+        const auto byte = delta.get<uint8_t>();
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+// what turns now into old, the part of old past the end of now is XORed
+// with zeroes
+static void
+encode_delta(std::span<const uint8_t> old,
+             std::span<const uint8_t> now,
+             std::vector<uint8_t>& out) {
+    StateWriter delta(out);
+
+    const size_t size   = old.size();
+    const size_t common = std::min(old.size(), now.size());
+
+    auto changed = [&](size_t i) {
+        return old[i] ^ (i < now.size() ? now[i] : 0);
+    };
+
+    out.clear();
+    delta.put<uint64_t>(size);
+
+    for (size_t i = 0; i < size;) {
+        const size_t skip_from = i;
+
+        /* most of the state is the same, a word at a time */
+        while (i + 8 <= common &&
+               std::memcmp(old.data() + i, now.data() + i, 8) == 0) {
+            i += 8;
+        }
+
+        while (i < size && changed(i) == 0) {
+            i++;
+        }
+
+        const size_t from = i;
+        size_t same       = 0;
+
+        while (i < size && same < SHORTEST_SKIP) {
+            same = changed(i) == 0 ? same + 1 : 0;
+            i++;
+        }
+
+        /* the unchanged bytes at the end go with the next run */
+        i -= same;
+
+        put_varint(delta, from - skip_from);
+        put_varint(delta, i - from);
+
+        for (size_t j = from; j < i; j++) {
+            delta.put<uint8_t>(changed(j));
+        }
+    }
+}
+
+static void
+apply_delta(std::span<const uint8_t> bytes, std::vector<uint8_t>& state) {
+    StateReader delta(bytes);
+
+    /* bytes past the end of the newer state were XORed with zeroes */
+    state.resize(delta.get<uint64_t>());
+
+    for (size_t i = 0; delta.remaining() > 0;) {
+        i += get_varint(delta);
+
+        const size_t length = get_varint(delta);
+
+        for (size_t end = i + length; i < end; i++) {
+            state[i] ^= delta.get<uint8_t>();
+        }
+    }
+}
+
+// slots handed to the thread, and back once it is done with them
+struct Rewind::Queues {
+    SPSCBuffer<uint32_t> queued;
+    SPSCBuffer<uint32_t> free;
+};
+
+Rewind::Rewind(Bus& bus, Cpu& cpu, RewindConfig config)
+  : bus(bus)
+  , cpu(cpu)
+  , config(config)
+  , captures(config.depth)
+  , queues(std::make_unique<Queues>(config.depth, config.depth)) {
+    for (uint32_t slot = 0; slot < config.depth; slot++) {
+        queues->free.push(slot);
+    }
+
+    thread = std::thread(&Rewind::run, this);
+}
+
+Rewind::~Rewind() {
+    stopping = true;
+    wakeups.fetch_add(1);
+    wakeups.notify_one();
+    thread.join();
+}
+
+void
+Rewind::frame() {
+    if (++frames < config.interval) {
+        return;
+    }
+
+    frames = 0;
+
+    uint32_t slot;
+
+    if (!queues->free.pop(slot)) {
+        drops++;
+        return;
+    }
+
+    save_state(bus, cpu, captures[slot]);
+
+    queues->queued.push(slot);
+    submitted++;
+
+    wakeups.fetch_add(1);
+    wakeups.notify_one();
+}
+
+void
+Rewind::restore(size_t steps) {
+    wait();
+
+    std::lock_guard guard(lock);
+
+    if (newest.empty() || steps > deltas.size()) {
+        throw std::out_of_range("Not that many states to rewind to");
+    }
+
+    for (; steps > 0; steps--) {
+        kept -= deltas.back().size() + newest.size();
+        apply_delta(deltas.back(), newest);
+        kept += newest.size();
+        deltas.pop_back();
+    }
+
+    load_state(bus, cpu, newest);
+    frames = 0;
+}
+
+size_t
+Rewind::states() const {
+    std::lock_guard guard(lock);
+    return newest.empty() ? 0 : deltas.size() + 1;
+}
+
+size_t
+Rewind::memory() const {
+    std::lock_guard guard(lock);
+    return kept + buffers;
+}
+
+void
+Rewind::wait() {
+    uint64_t done;
+
+    while ((done = finished.load()) != submitted) {
+        finished.wait(done);
+    }
+}
+
+void
+Rewind::run() {
+    uint64_t seen = 0;
+
+    while (true) {
+        wakeups.wait(seen);
+        seen = wakeups.load();
+
+        uint32_t slot;
+
+        while (queues->queued.pop(slot)) {
+            compress(captures[slot]);
+            queues->free.push(slot);
+
+            finished.fetch_add(1);
+            finished.notify_all();
+        }
+
+        if (stopping) {
+            break;
+        }
+    }
+}
+
+void
+Rewind::compress(std::vector<uint8_t>& state) {
+    {
+        /* the state becomes the newest, and the one it replaces is left in
+         * the slot to be written over by a later capture */
+        std::lock_guard guard(lock);
+        std::swap(state, newest);
+
+        if (state.empty()) {
+            kept    = newest.size();
+            buffers = config.depth * newest.size();
+            return;
+        }
+    }
+
+    encode_delta(state, newest, scratch);
+
+    std::lock_guard guard(lock);
+
+    /* every slot ends up holding a whole state, and scratch stays as big as
+     * the biggest delta yet */
+    kept += scratch.size() + newest.size() - state.size();
+    buffers = config.depth * newest.size() + scratch.capacity();
+    deltas.emplace_back(scratch.begin(), scratch.end());
+
+    while (kept + buffers > config.budget && !deltas.empty()) {
+        kept -= deltas.front().size();
+        deltas.pop_front();
+    }
+}
+}
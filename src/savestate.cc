@@ -0,0 +1,180 @@
+#include "savestate.hh"
+#include "bus.hh"
+#include "cpu/cpu.hh"
+#include "util/hash.hh"
+#include "util/state.hh"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <stdexcept>
+
+namespace matar {
+namespace {
+struct StateHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t scheduler;
+    uint64_t rom_hash;
+    // bytes of state following the header, a hash of them comes after
+    uint64_t size;
+};
+}
+
+static constexpr char MAGIC[8] = { 'M', 'A', 'T', 'A', 'R', 'S', 'A', 'V' };
+
+#ifdef TIMING_WHEEL_SCHEDULER
+static constexpr uint32_t SCHEDULER = 1;
+#else
+static constexpr uint32_t SCHEDULER = 0;
+#endif
+
+std::string_view
+savestate_scheduler() {
+    return SCHEDULER == 1 ? "wheel" : "heap";
+}
+
+void
+save_state(const Bus& bus, const Cpu& cpu, std::vector<uint8_t>& out) {
+    StateHeader header = {};
+
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version   = SAVESTATE_VERSION;
+    header.scheduler = SCHEDULER;
+    header.rom_hash  = bus.rom_hash();
+
+    out.clear();
+
+    StateWriter state(out);
+
+    state.put(header);
+    cpu.save(state);
+    bus.save(state);
+
+    /* the size is only known now */
+    const auto body = std::span(out).subspan(sizeof(StateHeader));
+    const uint64_t size = body.size();
+    const uint64_t hash = hash::xxh64(body);
+
+    std::memcpy(out.data() + offsetof(StateHeader, size), &size, sizeof(size));
+    state.put(hash);
+}
+
+std::vector<uint8_t>
+save_state(const Bus& bus, const Cpu& cpu) {
+    std::vector<uint8_t> out;
+    save_state(bus, cpu, out);
+    return out;
+}
+
+// the part of a state that follows the header, without the hash
+static std::span<const uint8_t>
+body_of(std::span<const uint8_t> state) {
+    return state.subspan(sizeof(StateHeader),
+                         state.size() - sizeof(StateHeader) - sizeof(uint64_t));
+}
+
+static void
+load_body(Bus& bus, Cpu& cpu, std::span<const uint8_t> body) {
+    StateReader reader(body);
+
+    cpu.load(reader);
+    bus.load(reader);
+
+    if (reader.remaining() != 0) {
+        throw std::invalid_argument("Savestate has more in it than expected");
+    }
+}
+
+void
+load_state(Bus& bus, Cpu& cpu, std::span<const uint8_t> state) {
+    StateHeader header;
+    uint64_t hash;
+
+    if (state.size() < sizeof(header) + sizeof(hash)) {
+        throw std::invalid_argument("Savestate is too short");
+    }
+
+    std::memcpy(&header, state.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::invalid_argument("Not a savestate");
+    }
+
+    if (header.version != SAVESTATE_VERSION) {
+        throw std::invalid_argument(
+          std::format("Savestate is version {}, only version {} is supported",
+                      header.version,
+                      SAVESTATE_VERSION));
+    }
+
+    if (header.scheduler != SCHEDULER) {
+        throw std::invalid_argument(
+          "Savestate was saved with another kind of scheduler");
+    }
+
+    if (header.rom_hash != bus.rom_hash()) {
+        throw std::invalid_argument("Savestate is of another ROM");
+    }
+
+    if (header.size != state.size() - sizeof(header) - sizeof(hash)) {
+        throw std::invalid_argument("Savestate is cut short");
+    }
+
+    const auto body = body_of(state);
+    std::memcpy(&hash, body.data() + body.size(), sizeof(hash));
+
+    if (hash::xxh64(body) != hash) {
+        throw std::invalid_argument("Savestate is corrupt");
+    }
+
+    /* a body laid out another way is only found out while loading it, by
+     * then the machine has changed and is put back the way it was */
+    std::vector<uint8_t> before;
+    save_state(bus, cpu, before);
+
+    try {
+        load_body(bus, cpu, body);
+    } catch (const std::out_of_range&) {
+        load_body(bus, cpu, body_of(before));
+        throw std::invalid_argument("Savestate ends early");
+    } catch (const std::invalid_argument&) {
+        load_body(bus, cpu, body_of(before));
+        throw;
+    }
+}
+
+void
+save_state_file(const Bus& bus, const Cpu& cpu, const std::string& path) {
+    std::vector<uint8_t> state = save_state(bus, cpu);
+    std::FILE* file            = std::fopen(path.c_str(), "wb");
+
+    if (file == nullptr) {
+        throw std::ios::failure("Could not open " + path, std::error_code());
+    }
+
+    const bool written =
+      std::fwrite(state.data(), 1, state.size(), file) == state.size();
+
+    if (std::fclose(file) != 0 || !written) {
+        throw std::ios::failure("Could not write " + path, std::error_code());
+    }
+}
+
+void
+load_state_file(Bus& bus, Cpu& cpu, const std::string& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+
+    if (!file.is_open()) {
+        throw std::ios::failure("Could not open " + path, std::error_code());
+    }
+
+    std::vector<uint8_t> state((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+
+    load_state(bus, cpu, state);
+}
+}
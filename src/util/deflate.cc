@@ -0,0 +1,282 @@
+#include "deflate.hh"
+#include <algorithm>
+#include <array>
+
+namespace deflate {
+
+static constexpr uint32_t WINDOW_SIZE = 32 * 1024;
+static constexpr uint32_t MIN_MATCH   = 3;
+static constexpr uint32_t MAX_MATCH   = 258;
+static constexpr uint32_t HASH_BITS   = 15;
+/* candidates looked at before settling for the best match so far */
+static constexpr uint32_t MAX_CHAIN = 32;
+
+static constexpr uint32_t END_OF_BLOCK = 256;
+
+static constexpr std::array<uint16_t, 29> LENGTH_BASE = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static constexpr std::array<uint8_t, 29> LENGTH_EXTRA = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static constexpr std::array<uint16_t, 30> DISTANCE_BASE = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577
+};
+static constexpr std::array<uint8_t, 30> DISTANCE_EXTRA = {
+    0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/* Huffman codes are sent starting from their top bit, unlike everything else
+ * in the stream */
+static constexpr uint32_t
+reverse(uint32_t code, uint32_t length) {
+    uint32_t reversed = 0;
+
+    for (uint32_t i = 0; i < length; i++) {
+        reversed = reversed << 1 | (code >> i & 1);
+    }
+
+    return reversed;
+}
+
+struct Code {
+    uint16_t bits;
+    uint8_t length;
+};
+
+/* the fixed literal/length codes, already reversed */
+static constexpr std::array<Code, 288> FIXED_CODES = [] {
+    std::array<Code, 288> codes = {};
+
+    for (uint32_t symbol = 0; symbol < codes.size(); symbol++) {
+        uint32_t code, length;
+
+        if (symbol < 144) {
+            code = 0x30 + symbol, length = 8;
+        } else if (symbol < 256) {
+            code = 0x190 + symbol - 144, length = 9;
+        } else if (symbol < 280) {
+            code = symbol - 256, length = 7;
+        } else {
+            code = 0xC0 + symbol - 280, length = 8;
+        }
+
+        codes[symbol] = { static_cast<uint16_t>(reverse(code, length)),
+                          static_cast<uint8_t>(length) };
+    }
+
+    return codes;
+}();
+
+namespace {
+class BitWriter {
+  public:
+    explicit BitWriter(std::vector<uint8_t>& out)
+      : out(out) {}
+
+    void put(uint32_t bits, uint32_t count) {
+        buffer |= static_cast<uint64_t>(bits) << used;
+        used += count;
+
+        while (used >= 8) {
+            out.push_back(static_cast<uint8_t>(buffer));
+            buffer >>= 8;
+            used -= 8;
+        }
+    }
+
+    void put_symbol(uint32_t symbol) {
+        put(FIXED_CODES[symbol].bits, FIXED_CODES[symbol].length);
+    }
+
+    void flush() {
+        if (used > 0) {
+            out.push_back(static_cast<uint8_t>(buffer));
+        }
+
+        buffer = 0;
+        used   = 0;
+    }
+
+  private:
+    std::vector<uint8_t>& out;
+    uint64_t buffer = 0;
+    uint32_t used   = 0;
+};
+}
+
+static void
+put_match(BitWriter& writer, uint32_t length, uint32_t distance) {
+    const uint32_t length_code =
+      std::ranges::upper_bound(LENGTH_BASE, length) - LENGTH_BASE.begin() - 1;
+    const uint32_t distance_code =
+      std::ranges::upper_bound(DISTANCE_BASE, distance) -
+      DISTANCE_BASE.begin() - 1;
+
+    writer.put_symbol(257 + length_code);
+    writer.put(length - LENGTH_BASE[length_code], LENGTH_EXTRA[length_code]);
+
+    /* distance codes are all 5 bits long */
+    writer.put(reverse(distance_code, 5), 5);
+    writer.put(distance - DISTANCE_BASE[distance_code],
+               DISTANCE_EXTRA[distance_code]);
+}
+
+std::vector<uint8_t>
+compress(std::span<const uint8_t> data) {
+    std::vector<uint8_t> out;
+    BitWriter writer(out);
+
+    out.reserve(data.size() / 2 + 16);
+
+    /* a single final block with fixed codes */
+    writer.put(1, 1);
+    writer.put(1, 2);
+
+    const uint32_t size = data.size();
+
+    /* positions of earlier strings by the hash of their first 3 bytes,
+     * chained to earlier ones with the same hash */
+    std::vector<int32_t> head(1 << HASH_BITS, -1);
+    std::vector<int32_t> previous(WINDOW_SIZE, -1);
+
+    auto hash = [&data](uint32_t i) {
+        uint32_t key = data[i] | data[i + 1] << 8 | data[i + 2] << 16;
+        return key * 2654435761u >> (32 - HASH_BITS);
+    };
+
+    auto insert = [&](uint32_t i) {
+        if (i + MIN_MATCH <= size) {
+            uint32_t h                  = hash(i);
+            previous[i % WINDOW_SIZE] = head[h];
+            head[h]                     = i;
+        }
+    };
+
+    uint32_t i = 0;
+
+    while (i < size) {
+        uint32_t best_length = 0, best_distance = 0;
+
+        if (i + MIN_MATCH <= size) {
+            const uint32_t longest = std::min(MAX_MATCH, size - i);
+            int32_t candidate      = head[hash(i)];
+
+            for (uint32_t chain = 0; chain < MAX_CHAIN && candidate >= 0 &&
+                                     i - candidate <= WINDOW_SIZE;
+                 chain++) {
+                uint32_t length = 0;
+
+                while (length < longest &&
+                       data[candidate + length] == data[i + length]) {
+                    length++;
+                }
+
+                if (length > best_length) {
+                    best_length   = length;
+                    best_distance = i - candidate;
+
+                    if (length == longest) {
+                        break;
+                    }
+                }
+
+                /* a slot reused by a later position ends the chain */
+                int32_t next = previous[candidate % WINDOW_SIZE];
+                candidate    = next < candidate ? next : -1;
+            }
+        }
+
+        if (best_length >= MIN_MATCH) {
+            put_match(writer, best_length, best_distance);
+
+            for (uint32_t end = i + best_length; i < end; i++) {
+                insert(i);
+            }
+        } else {
+            writer.put_symbol(data[i]);
+            insert(i);
+            i++;
+        }
+    }
+
+    writer.put_symbol(END_OF_BLOCK);
+    writer.flush();
+
+    return out;
+}
+
+std::vector<uint8_t>
+zlib_compress(std::span<const uint8_t> data) {
+    /* deflate with a 32K window and the fastest level, which makes the
+     * header a multiple of 31 */
+    std::vector<uint8_t> out = { 0x78, 0x01 };
+    std::vector<uint8_t> block = compress(data);
+    uint32_t adler             = adler32(data);
+
+    out.insert(out.end(), block.begin(), block.end());
+
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(adler >> shift));
+    }
+
+    return out;
+}
+
+uint32_t
+adler32(std::span<const uint8_t> data, uint32_t adler) {
+    static constexpr uint32_t MOD = 65521;
+    /* most bytes that can be summed before the sums could overflow */
+    static constexpr size_t RUN = 5552;
+
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+
+    while (!data.empty()) {
+        const size_t run = std::min(data.size(), RUN);
+
+        for (uint8_t byte : data.first(run)) {
+            a += byte;
+            b += a;
+        }
+
+        a %= MOD;
+        b %= MOD;
+        data = data.subspan(run);
+    }
+
+    return b << 16 | a;
+}
+
+uint32_t
+crc32(std::span<const uint8_t> data, uint32_t crc) {
+    static constexpr std::array<uint32_t, 256> TABLE = [] {
+        std::array<uint32_t, 256> table = {};
+
+        for (uint32_t n = 0; n < table.size(); n++) {
+            uint32_t c = n;
+
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+
+            table[n] = c;
+        }
+
+        return table;
+    }();
+
+    crc = ~crc;
+
+    for (uint8_t byte : data) {
+        crc = TABLE[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Just enough of deflate and zlib to write PNG files without pulling in a
+// library. Matches are found greedily and coded with the fixed Huffman codes,
+// which is nowhere near the best compression but cheap to produce.
+namespace deflate {
+
+// data as one deflate block
+std::vector<uint8_t>
+compress(std::span<const uint8_t> data);
+
+// data as a zlib stream, a deflate block with a header and a checksum
+std::vector<uint8_t>
+zlib_compress(std::span<const uint8_t> data);
+
+uint32_t
+adler32(std::span<const uint8_t> data, uint32_t adler = 1);
+
+// the CRC-32 used by zlib and PNG, pass the result of the previous call to
+// continue it over more data
+uint32_t
+crc32(std::span<const uint8_t> data, uint32_t crc = 0);
+}
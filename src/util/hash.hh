@@ -0,0 +1,102 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// 64 bit XXH64 hashes, fast enough to hash every frame that is rendered
+namespace hash {
+
+static constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87;
+static constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4F;
+static constexpr uint64_t PRIME3 = 0x165667B19E3779F9;
+static constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63;
+static constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5;
+
+inline uint64_t
+round(uint64_t acc, uint64_t input) {
+    return std::rotl(acc + input * PRIME2, 31) * PRIME1;
+}
+
+inline uint64_t
+merge_round(uint64_t acc, uint64_t value) {
+    return (acc ^ round(0, value)) * PRIME1 + PRIME4;
+}
+
+inline uint64_t
+avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+inline uint64_t
+xxh64(std::span<const uint8_t> data, uint64_t seed = 0) {
+    auto read64 = [](const uint8_t* p) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    };
+
+    auto read32 = [](const uint8_t* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    };
+
+    const uint8_t* p   = data.data();
+    const uint8_t* end = p + data.size();
+    uint64_t h;
+
+    if (data.size() >= 32) {
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+
+        for (; end - p >= 32; p += 32) {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+        }
+
+        h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+            std::rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    } else {
+        h = seed + PRIME5;
+    }
+
+    h += data.size();
+
+    for (; end - p >= 8; p += 8) {
+        h = std::rotl(h ^ round(0, read64(p)), 27) * PRIME1 + PRIME4;
+    }
+
+    if (end - p >= 4) {
+        h = std::rotl(h ^ read32(p) * PRIME1, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+
+    for (; p < end; p++) {
+        h = std::rotl(h ^ *p * PRIME5, 11) * PRIME1;
+    }
+
+    return avalanche(h);
+}
+
+// folds one more value into a running hash, for hashing a stream of values as
+// they come instead of all at once
+inline uint64_t
+combine(uint64_t h, uint64_t value) {
+    return std::rotl(h ^ round(0, value), 27) * PRIME1 + PRIME4;
+}
+}
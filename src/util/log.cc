@@ -1,4 +1,185 @@
 #include "log.hh"
+#include "util/spsc.hh"
+#include <chrono>
+#include <utility>
+
+namespace logging {
+/* how long records can wait for the writer when nothing hurries it */
+static constexpr auto WRITE_INTERVAL = std::chrono::milliseconds(10);
+
+struct Logger::Ring {
+    SPSCBuffer<Record> records{ RING_SIZE };
+    /* records pushed since the writer last emptied the ring */
+    std::atomic<size_t> pending = 0;
+    std::atomic<bool> owned     = false;
+};
+
+namespace {
+/* a ring held by the thread, given back when the thread exits */
+struct RingHandle {
+    uint64_t logger;
+    std::shared_ptr<void> ring;
+    std::atomic<bool>* owned;
+
+    RingHandle(uint64_t logger,
+               std::shared_ptr<void> ring,
+               std::atomic<bool>* owned)
+      : logger(logger)
+      , ring(std::move(ring))
+      , owned(owned) {}
+
+    RingHandle(RingHandle&& other) noexcept
+      : logger(other.logger)
+      , ring(std::move(other.ring))
+      , owned(std::exchange(other.owned, nullptr)) {}
+
+    ~RingHandle() {
+        if (owned != nullptr) {
+            owned->store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local std::vector<RingHandle> thread_rings;
+
+std::atomic<uint64_t> next_id = 0;
+}
+
+Logger::Logger(LogLevel level, FILE* stream)
+  : id(next_id.fetch_add(1))
+  , level(0)
+  , stream(stream) {
+    set_level(level);
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard guard(wake_lock);
+        stopping = true;
+    }
+
+    wake.notify_one();
+
+    if (writer.joinable()) {
+        writer.join();
+    }
+
+    drain();
+}
+
+void
+Logger::set_stream(FILE* stream) {
+    flush();
+
+    std::lock_guard guard(drain_lock);
+    this->stream = stream;
+}
+
+void
+Logger::flush() {
+    drain();
+}
+
+Logger::Ring&
+Logger::thread_ring() {
+    for (const RingHandle& handle : thread_rings) {
+        if (handle.logger == id) {
+            return *static_cast<Ring*>(handle.ring.get());
+        }
+    }
+
+    std::lock_guard guard(rings_lock);
+    std::shared_ptr<Ring> ring;
+
+    /* rings of threads that are gone can be taken over as they are, what
+     * is left in them is still written out in order */
+    for (const auto& candidate : rings) {
+        bool owned = false;
+
+        if (candidate->owned.compare_exchange_strong(
+              owned, true, std::memory_order_acquire)) {
+            ring = candidate;
+            break;
+        }
+    }
+
+    if (!ring) {
+        ring        = std::make_shared<Ring>();
+        ring->owned = true;
+        rings.push_back(ring);
+    }
+
+    thread_rings.emplace_back(id, ring, &ring->owned);
+    return *ring;
+}
+
+void
+Logger::submit(const Record& record) {
+    std::call_once(started,
+                   [this]() { writer = std::thread(&Logger::run, this); });
+
+    Ring& ring = thread_ring();
+
+    if (!ring.records.push(record)) {
+        drops.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    /* wake the writer up early when the ring is getting full */
+    if (ring.pending.fetch_add(1, std::memory_order_relaxed) ==
+        RING_SIZE / 2) {
+        wake.notify_one();
+    }
+}
+
+void
+Logger::run() {
+    std::unique_lock guard(wake_lock);
+
+    while (!stopping) {
+        wake.wait_for(guard, WRITE_INTERVAL);
+
+        guard.unlock();
+        drain();
+        guard.lock();
+    }
+}
+
+void
+Logger::drain() {
+    std::lock_guard drain_guard(drain_lock);
+    std::lock_guard rings_guard(rings_lock);
+
+    bool written = false;
+
+    for (const auto& ring : rings) {
+        Record record;
+
+        ring->pending.store(0, std::memory_order_relaxed);
+
+        while (ring->records.pop(record)) {
+            std::fwrite(record.text, 1, record.length, stream);
+            written = true;
+        }
+    }
+
+    const uint64_t dropped = drops.load(std::memory_order_relaxed);
+
+    if (dropped != drops_reported) {
+        std::fprintf(stream,
+                     "%s[WARN] %llu log messages dropped\n%s",
+                     ansi::YELLOW,
+                     static_cast<unsigned long long>(dropped - drops_reported),
+                     ansi::RESET);
+        drops_reported = dropped;
+        written        = true;
+    }
+
+    if (written) {
+        std::fflush(stream);
+    }
+}
+}
 
 logging::Logger glogger = logging::Logger();
 
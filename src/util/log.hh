@@ -1,7 +1,23 @@
 #pragma once
 
 #include "util/loglevel.hh"
-#include <print>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <format>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// most verbose level that is compiled in, calls above it generate no code
+#ifndef LOG_LEVEL
+#define LOG_LEVEL Debug
+#endif
 
 namespace logging {
 namespace ansi {
@@ -13,76 +29,183 @@ static constexpr auto BOLD    = "\033[1m";
 static constexpr auto RESET   = "\033[0m";
 }
 
-using std::print;
+// whether calls at this level are compiled in
+constexpr bool
+compiled(matar::LogLevel level) {
+    return static_cast<uint8_t>(level) <=
+           static_cast<uint8_t>(matar::LogLevel::LOG_LEVEL);
+}
 
+// Messages are formatted on the thread logging them into a ring of records of
+// its own, and written out by a thread of the logger's, so that logging never
+// waits on the stream. A message that does not fit in a record is cut short
+// and one that does not fit in the ring is dropped and counted.
 class Logger {
     using LogLevel = matar::LogLevel;
 
   public:
-    Logger(LogLevel level = LogLevel::Debug, FILE* stream = stdout)
-      : level(0)
-      , stream(stream) {
-        set_level(level);
-    }
+    // longest message written, along with its level and colors
+    static constexpr size_t RECORD_SIZE = 256;
+    // records that can wait in the ring of each thread
+    static constexpr size_t RING_SIZE = 1024;
+
+    Logger(LogLevel level = LogLevel::Debug, FILE* stream = stdout);
+
+    // writes out whatever is still waiting
+    ~Logger();
+
+    Logger(const Logger&)            = delete;
+    Logger& operator=(const Logger&) = delete;
 
     template<typename... Args>
     void log(const std::format_string<Args...>& fmt, Args&&... args) {
-        std::println(stream, fmt, std::forward<Args>(args)...);
+        write({}, "", fmt, std::forward<Args>(args)...);
     }
 
     template<typename... Args>
     void debug(const std::format_string<Args...>& fmt, Args&&... args) {
-        if (level & static_cast<uint8_t>(LogLevel::Debug)) {
-            print(stream, "{}{}[DEBUG] ", ansi::MAGENTA, ansi::BOLD);
-            log(fmt, std::forward<Args>(args)...);
-            print(stream, ansi::RESET);
+        if constexpr (compiled(LogLevel::Debug)) {
+            if (enabled(LogLevel::Debug)) {
+                write({ ansi::MAGENTA, ansi::BOLD, "[DEBUG] " },
+                      ansi::RESET,
+                      fmt,
+                      std::forward<Args>(args)...);
+            }
         }
     }
 
     template<typename... Args>
     void info(const std::format_string<Args...>& fmt, Args&&... args) {
-        if (level & static_cast<uint8_t>(LogLevel::Info)) {
-            print(stream, "{}[INFO] ", ansi::WHITE);
-            log(fmt, std::forward<Args>(args)...);
-            print(stream, ansi::RESET);
+        if constexpr (compiled(LogLevel::Info)) {
+            if (enabled(LogLevel::Info)) {
+                write({ ansi::WHITE, "[INFO] " },
+                      ansi::RESET,
+                      fmt,
+                      std::forward<Args>(args)...);
+            }
         }
     }
 
     template<typename... Args>
     void info_bold(const std::format_string<Args...>& fmt, Args&&... args) {
-        if (level & static_cast<uint8_t>(LogLevel::Info)) {
-            print(stream, "{}{}[INFO] ", ansi::WHITE, ansi::BOLD);
-            log(fmt, std::forward<Args>(args)...);
-            print(stream, ansi::RESET);
+        if constexpr (compiled(LogLevel::Info)) {
+            if (enabled(LogLevel::Info)) {
+                write({ ansi::WHITE, ansi::BOLD, "[INFO] " },
+                      ansi::RESET,
+                      fmt,
+                      std::forward<Args>(args)...);
+            }
         }
     }
 
     template<typename... Args>
     void warn(const std::format_string<Args...>& fmt, Args&&... args) {
-        if (level & static_cast<uint8_t>(LogLevel::Warn)) {
-            print(stream, "{}[WARN] ", ansi::YELLOW);
-            log(fmt, std::forward<Args>(args)...);
-            print(stream, ansi::RESET);
+        if constexpr (compiled(LogLevel::Warn)) {
+            if (enabled(LogLevel::Warn)) {
+                write({ ansi::YELLOW, "[WARN] " },
+                      ansi::RESET,
+                      fmt,
+                      std::forward<Args>(args)...);
+            }
         }
     }
 
     template<typename... Args>
     void error(const std::format_string<Args...>& fmt, Args&&... args) {
-        if (level & static_cast<uint8_t>(LogLevel::Error)) {
-            print(stream, "{}{}[ERROR] ", ansi::RED, ansi::BOLD);
-            log(fmt, std::forward<Args>(args)...);
-            print(stream, ansi::RESET);
+        if constexpr (compiled(LogLevel::Error)) {
+            if (enabled(LogLevel::Error)) {
+                write({ ansi::RED, ansi::BOLD, "[ERROR] " },
+                      ansi::RESET,
+                      fmt,
+                      std::forward<Args>(args)...);
+            }
         }
     }
 
+    // whether a call at this level would log anything, for leaving out work
+    // that only goes into a message
+    bool enabled(LogLevel level) const {
+        return compiled(level) && (this->level.load(std::memory_order_relaxed) &
+                                   static_cast<uint8_t>(level));
+    }
+
     void set_level(LogLevel level) {
-        this->level = (static_cast<uint8_t>(level) << 1) - 1;
+        this->level.store((static_cast<uint8_t>(level) << 1) - 1,
+                          std::memory_order_relaxed);
     }
-    void set_stream(FILE* stream) { this->stream = stream; }
+
+    // records logged before are written to the stream set before
+    void set_stream(FILE* stream);
+
+    // writes out every record logged so far, from any thread, before
+    // returning
+    void flush();
+
+    // records that did not fit in their ring
+    uint64_t dropped() const { return drops.load(); }
 
   private:
-    uint8_t level;
+    struct Record {
+        uint16_t length;
+        char text[RECORD_SIZE];
+    };
+
+    struct Ring;
+
+    /* tells loggers apart for the threads holding rings of theirs */
+    const uint64_t id;
+
+    std::atomic<uint8_t> level;
     FILE* stream;
+
+    /* rings are handed to threads as they first log and taken back when
+     * they exit, to be handed out again */
+    std::mutex rings_lock;
+    std::vector<std::shared_ptr<Ring>> rings;
+
+    /* only one thread takes records out of the rings at a time */
+    std::mutex drain_lock;
+    std::mutex wake_lock;
+    std::condition_variable wake;
+    std::once_flag started;
+    std::thread writer;
+    bool stopping = false;
+
+    std::atomic<uint64_t> drops = 0;
+    uint64_t drops_reported     = 0;
+
+    template<typename... Args>
+    void write(std::initializer_list<std::string_view> prefix,
+               std::string_view suffix,
+               const std::format_string<Args...>& fmt,
+               Args&&... args) {
+        Record record;
+
+        /* the message is cut short before the suffix and newline, to leave
+         * room for them */
+        const size_t room = RECORD_SIZE - suffix.size() - 1;
+        char* end         = record.text;
+
+        for (std::string_view part : prefix) {
+            end = std::copy(part.begin(), part.end(), end);
+        }
+
+        end = std::format_to_n(end,
+                               room - (end - record.text),
+                               fmt,
+                               std::forward<Args>(args)...)
+                .out;
+        *end++ = '\n';
+        end    = std::copy(suffix.begin(), suffix.end(), end);
+
+        record.length = end - record.text;
+        submit(record);
+    }
+
+    void submit(const Record& record);
+    Ring& thread_ring();
+    void run();
+    void drain();
 };
 }
 
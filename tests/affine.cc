@@ -0,0 +1,133 @@
+#include "io/display/affine_samplers.hh"
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <vector>
+
+#define TAG "[display][affine]"
+
+using namespace matar::display;
+
+#ifdef AFFINE_AVX2
+namespace {
+// VRAM and all of PRAM filled at random, a few colors left at 0 so that
+// transparent texels come up often
+struct Memories {
+    explicit Memories(uint32_t seed)
+      : random(seed)
+      , vram(VRAM_SIZE)
+      , palette(512) {
+        for (auto& byte : vram) {
+            byte = random() % 4 == 0 ? 0 : random();
+        }
+
+        for (auto& color : palette) {
+            color = random() & 0x7FFF;
+        }
+    }
+
+    int32_t between(int32_t low, int32_t high) {
+        return std::uniform_int_distribution<int32_t>(low, high)(random);
+    }
+
+    static constexpr uint32_t VRAM_SIZE = 0x18000;
+
+    std::mt19937 random;
+    std::vector<uint8_t> vram;
+    std::vector<uint16_t> palette;
+};
+}
+
+TEST_CASE("AVX2 affine backgrounds match the scalar ones", TAG) {
+    /* nothing to check the scalar sampler against */
+    if (!has_avx2()) {
+        return;
+    }
+
+    Memories memories(1);
+
+    for (int run = 0; run < 2000; run++) {
+        const int32_t size = 128 << memories.between(0, 3);
+
+        /* steps from small to far past a texel a pixel, either way, and
+         * origins well off the background */
+        const int32_t reach = run % 4 == 0 ? 0x7FFF : 0x200;
+
+        AffineBackground bg = {
+            .vram       = memories.vram.data(),
+            .palette    = memories.palette.data(),
+            .tile_base  = 0x4000u * memories.between(0, 3),
+            .map_base   = 0x800u * memories.between(0, 31),
+            .size       = size,
+            .wraparound = run % 2 == 0,
+            .origin     = { memories.between(-size << 9, size << 9),
+                            memories.between(-size << 9, size << 9) },
+            .step       = { memories.between(-reach, reach),
+                            memories.between(-reach, reach) },
+        };
+
+        std::array<uint16_t, LCD_WIDTH> scalar;
+        std::array<uint16_t, LCD_WIDTH> avx2;
+
+        sample_affine_background_scalar(bg, scalar);
+        sample_affine_background_avx2(bg, avx2);
+
+        INFO("run " << run);
+        REQUIRE(avx2 == scalar);
+    }
+}
+
+TEST_CASE("AVX2 affine objects match the scalar ones", TAG) {
+    /* nothing to check the scalar sampler against */
+    if (!has_avx2()) {
+        return;
+    }
+
+    Memories memories(2);
+
+    for (int run = 0; run < 2000; run++) {
+        const Vec2<int32_t> size = { 8 << memories.between(0, 3),
+                                     8 << memories.between(0, 3) };
+        const bool colors256 = run % 2 == 0;
+        const int32_t reach  = run % 4 < 2 ? 0x7FFF : 0x200;
+        /* 256 color objects use the whole of the object palette */
+        const uint32_t bank = colors256 ? 0 : memories.between(0, 15);
+
+        /* tiles near the end of VRAM run past it now and then */
+        const uint32_t vram_size = run % 3 == 0 ? 0x10400 : Memories::VRAM_SIZE;
+        const uint32_t tile_base =
+          run % 3 == 0 ? 0x10000 + 32u * memories.between(0, 31)
+                       : 0x10000 + 32u * memories.between(0, 1023);
+
+        AffineObject obj = {
+            .vram           = memories.vram.data(),
+            .vram_size      = vram_size,
+            .palette        = memories.palette.data(),
+            .palette_offset = 256 + bank * 16,
+            .tile_base      = tile_base,
+            .tiles_per_row  = static_cast<uint32_t>(
+              memories.between(1, 32) * (colors256 ? 2 : 1)),
+            .colors256      = colors256,
+            .size           = size,
+            .origin         = { memories.between(-size.x << 9, size.x << 9),
+                                memories.between(-size.y << 9, size.y << 9) },
+            .step           = { memories.between(-reach, reach),
+                                memories.between(-reach, reach) },
+        };
+
+        /* runs of any length, odd ones leave a tail of fewer than 8 */
+        const size_t length = memories.between(1, 2 * 64);
+
+        std::vector<uint16_t> scalar(length);
+        std::vector<uint16_t> avx2(length);
+
+        sample_affine_object_scalar(obj, scalar);
+        sample_affine_object_avx2(obj, avx2);
+
+        INFO("run " << run);
+        REQUIRE(avx2 == scalar);
+    }
+}
+#endif
+
+#undef TAG
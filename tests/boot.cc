@@ -0,0 +1,127 @@
+#include "boot.hh"
+#include "machine.hh"
+#include "savestate.hh"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+
+#define TAG "[boot]"
+
+TEST_CASE("direct boot starts at the cartridge", TAG) {
+    Machine machine;
+
+    boot(machine.bus, machine.cpu, BootMode::Direct);
+
+    CHECK(machine.cpu.state() == State::Arm);
+    CHECK(machine.cpu.program_counter() == 0x08000008);
+    CHECK(machine.bus.read_byte(0x4000300) == 1);
+    CHECK(machine.bus.read_halfword(0x4000088) == 0x200);
+}
+
+TEST_CASE("snapshot boot runs the BIOS once", TAG) {
+    const auto cache = std::filesystem::temp_directory_path() /
+                       std::format("matar-boot-test-{}", getpid());
+    std::filesystem::remove_all(cache);
+
+    Machine first;
+    boot(first.bus, first.cpu, BootMode::Snapshot, cache);
+
+    // the BIOS only jumps to the cartridge
+    CHECK(first.cpu.program_counter() == 0x08000008);
+    REQUIRE(std::distance(std::filesystem::directory_iterator(cache),
+                          std::filesystem::directory_iterator()) == 1);
+
+    const auto snapshot =
+      std::filesystem::directory_iterator(cache)->path().string();
+
+    SECTION("later boots load the snapshot as it is") {
+        /* a state the BIOS never leaves the machine in, which only a boot
+         * that loads it instead of running the BIOS ends up in */
+        Machine ran;
+        ran.run(1'000);
+        save_state_file(ran.bus, ran.cpu, snapshot);
+
+        Machine second;
+        boot(second.bus, second.cpu, BootMode::Snapshot, cache);
+
+        CHECK(save_state(second.bus, second.cpu) ==
+              save_state(ran.bus, ran.cpu));
+    }
+
+    SECTION("a snapshot that does not load is written over") {
+        std::ofstream(snapshot, std::ios::binary | std::ios::trunc)
+          << "not a state";
+
+        Machine second;
+        boot(second.bus, second.cpu, BootMode::Snapshot, cache);
+
+        CHECK(save_state(second.bus, second.cpu) ==
+              save_state(first.bus, first.cpu));
+
+        Machine third;
+        load_state_file(third.bus, third.cpu, snapshot);
+        CHECK(save_state(third.bus, third.cpu) ==
+              save_state(first.bus, first.cpu));
+    }
+
+    SECTION("other ROMs get snapshots of their own") {
+        Machine other(1);
+        boot(other.bus, other.cpu, BootMode::Snapshot, cache);
+
+        CHECK(std::distance(std::filesystem::directory_iterator(cache),
+                            std::filesystem::directory_iterator()) == 2);
+    }
+
+    std::filesystem::remove_all(cache);
+}
+
+TEST_CASE("runs after a snapshot boot count from the snapshot", TAG) {
+    const auto cache = std::filesystem::temp_directory_path() /
+                       std::format("matar-boot-test-{}", getpid());
+    std::filesystem::remove_all(cache);
+
+    Machine machine;
+    boot(machine.bus, machine.cpu, BootMode::Snapshot, cache);
+
+    const uint64_t start = machine.bus.get_cycles();
+    REQUIRE(start > 0);
+
+    // as many cycles again, not up to the cycle the snapshot was taken at
+    machine.bus.run(start);
+    CHECK(machine.bus.get_cycles() >= 2 * start);
+
+    std::filesystem::remove_all(cache);
+}
+
+TEST_CASE("snapshots are cached in the user's cache directory", TAG) {
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    const std::string saved = xdg != nullptr ? xdg : "";
+
+    setenv("XDG_CACHE_HOME", "/cache", 1);
+    CHECK(default_boot_cache() == "/cache/matar");
+
+    setenv("XDG_CACHE_HOME", "", 1);
+    if (const char* home = std::getenv("HOME"); home != nullptr && *home) {
+        CHECK(default_boot_cache() ==
+              std::filesystem::path(home) / ".cache" / "matar");
+    }
+
+    if (xdg != nullptr) {
+        setenv("XDG_CACHE_HOME", saved.c_str(), 1);
+    } else {
+        unsetenv("XDG_CACHE_HOME");
+    }
+}
+
+TEST_CASE("boot modes are parsed by name", TAG) {
+    CHECK(parse_boot_mode("bios") == BootMode::Bios);
+    CHECK(parse_boot_mode("direct") == BootMode::Direct);
+    CHECK(parse_boot_mode("snapshot") == BootMode::Snapshot);
+    CHECK_THROWS_AS(parse_boot_mode("fast"), std::invalid_argument);
+}
+
+#undef TAG
@@ -0,0 +1,129 @@
+#include "io/display/capture.hh"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define TAG "[display][capture]"
+
+using namespace matar::display;
+
+namespace {
+class HeldSink : public FrameSink {
+  public:
+    std::atomic<bool> held = true;
+    std::vector<uint64_t> numbers;
+    std::vector<uint8_t> first_pixels;
+
+    void consume(const Frame& frame) override {
+        held.wait(true);
+        numbers.push_back(frame.number);
+        first_pixels.push_back(frame.pixels[0]);
+    }
+};
+
+Frame
+make_frame(std::vector<uint8_t>& pixels, uint64_t number) {
+    return Frame{
+        .pixels = pixels,
+        .format = PixelFormat::RGB555,
+        .width  = LCD_WIDTH,
+        .height = LCD_HEIGHT,
+        .pitch  = LCD_WIDTH * 2,
+        .number = number,
+    };
+}
+}
+
+TEST_CASE("queued sink drops frames when full", TAG) {
+    HeldSink sink;
+    std::vector<uint8_t> pixels(LCD_WIDTH * LCD_HEIGHT * 2);
+
+    {
+        QueuedSink queue(sink, 2);
+
+        for (uint8_t i = 1; i <= 4; i++) {
+            pixels[0] = i;
+            queue.consume(make_frame(pixels, i));
+        }
+
+        // one frame is with the sink and one is waiting, both slots are
+        // taken until the sink lets go
+        CHECK(queue.dropped() == 2);
+
+        sink.held = false;
+        sink.held.notify_one();
+    }
+
+    // the frames were copied when they were queued
+    CHECK(sink.numbers == std::vector<uint64_t>{ 1, 2 });
+    CHECK(sink.first_pixels == std::vector<uint8_t>{ 1, 2 });
+}
+
+TEST_CASE("queued sink keeps up with a fast sink", TAG) {
+    HeldSink sink;
+    std::vector<uint8_t> pixels(LCD_WIDTH * LCD_HEIGHT * 2);
+
+    uint64_t dropped = 0;
+
+    sink.held = false;
+
+    {
+        QueuedSink queue(sink, 4);
+
+        for (uint64_t i = 1; i <= 100; i++) {
+            queue.consume(make_frame(pixels, i));
+        }
+
+        dropped = queue.dropped();
+    }
+
+    // every frame was either handed over or dropped
+    CHECK(sink.numbers.size() + dropped == 100);
+
+    for (size_t i = 1; i < sink.numbers.size(); i++) {
+        CHECK(sink.numbers[i - 1] < sink.numbers[i]);
+    }
+}
+
+TEST_CASE("hash log", TAG) {
+    const auto path =
+      (std::filesystem::temp_directory_path() / "matar_hash_log_test").string();
+    std::vector<uint8_t> pixels(LCD_WIDTH * LCD_HEIGHT * 2);
+    uint64_t audio = 0;
+
+    {
+        HashLogSink log(path, [&audio]() { return audio++; });
+
+        log.consume(make_frame(pixels, 1));
+        log.consume(make_frame(pixels, 2));
+        pixels[100] = 1;
+        log.consume(make_frame(pixels, 3));
+    }
+
+    std::ifstream file(path);
+    std::vector<std::string> lines;
+
+    for (std::string line; std::getline(file, line);) {
+        lines.push_back(line);
+    }
+
+    std::remove(path.c_str());
+
+    REQUIRE(lines.size() == 3);
+
+    // frame number, 16 digits of pixel hash and 16 of audio hash
+    CHECK(lines[0].size() == 2 + 16 + 1 + 16);
+    CHECK(lines[0].starts_with("1 "));
+    CHECK(lines[0].ends_with(" 0000000000000000"));
+    CHECK(lines[1].ends_with(" 0000000000000001"));
+
+    // same pixels, same hash
+    CHECK(lines[0].substr(2, 16) == lines[1].substr(2, 16));
+    CHECK(lines[1].substr(2, 16) != lines[2].substr(2, 16));
+}
+
+#undef TAG
@@ -0,0 +1,22 @@
+#include "machine.hh"
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+
+#define TAG "[dma]"
+
+// DMA0CNT_H
+static constexpr uint32_t CONTROL = 0x40000BA;
+
+TEST_CASE("a DMA with the prohibited source control throws", TAG) {
+    Machine machine;
+    machine.run(1000);
+
+    // enabled, immediately, source address control 3; an immediate transfer
+    // only starts on a write to a channel that is already enabled
+    machine.bus.write_halfword(CONTROL, 0x8180);
+    machine.bus.write_halfword(CONTROL, 0x8180);
+
+    CHECK_THROWS_AS(machine.bus.run(1000), std::runtime_error);
+}
+
+#undef TAG
@@ -0,0 +1,72 @@
+#include "fork.hh"
+#include "machine.hh"
+#include "savestate.hh"
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+
+#define TAG "[fork]"
+
+static void
+run(Instance& instance, uint64_t cycles) {
+    instance.bus->run(cycles);
+}
+
+TEST_CASE("forks run on as the machine they were forked from", TAG) {
+    Machine machine(0, MemoryArena::forkable());
+    machine.run(50'000);
+
+    Instance first = fork(machine.bus, machine.cpu);
+    CHECK(save_state(*first.bus, *first.cpu) ==
+          save_state(machine.bus, machine.cpu));
+
+    machine.run(100'000);
+
+    // the machine has pages of its own now, which the next fork starts from
+    Instance second = fork(machine.bus, machine.cpu);
+    const auto forked = save_state(machine.bus, machine.cpu);
+    CHECK(save_state(*second.bus, *second.cpu) == forked);
+
+    run(first, 100'000);
+    CHECK(save_state(*first.bus, *first.cpu) == forked);
+
+    machine.run(100'000);
+    run(second, 100'000);
+    CHECK(save_state(*second.bus, *second.cpu) ==
+          save_state(machine.bus, machine.cpu));
+}
+
+TEST_CASE("forks do not see each other's writes", TAG) {
+    Machine machine(0, MemoryArena::forkable());
+    machine.bus.write_word(0x2000000, 1);
+    machine.bus.write_word(0x6000000, 1);
+
+    Instance child = fork(machine.bus, machine.cpu);
+
+    machine.bus.write_word(0x2000000, 2);
+    child.bus->write_word(0x6000000, 3);
+    child.bus->write_word(0x8000080, 4);
+
+    CHECK(machine.bus.read_word(0x2000000) == 2);
+    CHECK(child.bus->read_word(0x2000000) == 1);
+    CHECK(machine.bus.read_word(0x6000000) == 1);
+    CHECK(child.bus->read_word(0x6000000) == 3);
+    CHECK(machine.bus.read_word(0x8000080) == 0);
+    CHECK(child.bus->read_word(0x8000080) == 4);
+
+    // and forks of forks neither
+    Instance grandchild = fork(*child.bus, *child.cpu);
+    child.bus->write_word(0x6000000, 5);
+
+    CHECK(grandchild.bus->read_word(0x6000000) == 3);
+    CHECK(child.bus->read_word(0x6000000) == 5);
+}
+
+TEST_CASE("only machines with a forkable arena fork", TAG) {
+    Machine machine;
+    CHECK_THROWS_AS(fork(machine.bus, machine.cpu), std::logic_error);
+
+    Machine huge(0, std::make_unique<MemoryArena>());
+    CHECK_THROWS_AS(fork(huge.bus, huge.cpu), std::logic_error);
+}
+
+#undef TAG
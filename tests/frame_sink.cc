@@ -0,0 +1,77 @@
+#include "io/display/frame_sink.hh"
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+#define TAG "[display][frame sink]"
+
+using namespace matar::display;
+
+TEST_CASE("triple buffer handoff", TAG) {
+    TripleBuffer buffers;
+
+    CHECK(buffers.acquire() == nullptr);
+
+    uint8_t* first = buffers.back();
+    first[0]       = 1;
+    buffers.publish(PixelFormat::RGB565, 1);
+
+    // the renderer moves on to another buffer
+    CHECK(buffers.back() != first);
+
+    const Frame* frame = buffers.acquire();
+    REQUIRE(frame != nullptr);
+    CHECK(frame->number == 1);
+    CHECK(frame->pixels.data() == first);
+    CHECK(frame->pixels.size() == LCD_WIDTH * LCD_HEIGHT * 2);
+    CHECK(frame->pitch == LCD_WIDTH * 2);
+
+    // nothing new
+    CHECK(buffers.acquire() == nullptr);
+
+    // the acquired frame is left alone while newer ones are rendered
+    buffers.publish(PixelFormat::RGB565, 2);
+    CHECK(buffers.back() != first);
+    buffers.publish(PixelFormat::RGBA8888, 3);
+    CHECK(buffers.back() != first);
+    CHECK(buffers.dropped() == 1);
+
+    frame = buffers.acquire();
+    REQUIRE(frame != nullptr);
+    CHECK(frame->number == 3);
+    CHECK(frame->format == PixelFormat::RGBA8888);
+    CHECK(frame->pixels.size() == LCD_WIDTH * LCD_HEIGHT * 4);
+}
+
+namespace {
+class CollectingSink : public FrameSink {
+  public:
+    std::vector<uint64_t> numbers;
+
+    void consume(const Frame& frame) override {
+        numbers.push_back(frame.number);
+    }
+};
+}
+
+TEST_CASE("sink thread", TAG) {
+    TripleBuffer buffers;
+    CollectingSink sink;
+
+    {
+        SinkThread thread(buffers, sink);
+
+        for (uint64_t i = 1; i <= 100; i++) {
+            buffers.publish(PixelFormat::RGB555, i);
+            thread.notify();
+        }
+    }
+
+    // frames may be dropped, but never the last one and never reordered
+    REQUIRE(!sink.numbers.empty());
+    CHECK(sink.numbers.back() == 100);
+    CHECK(sink.numbers.size() + buffers.dropped() == 100);
+
+    for (size_t i = 1; i < sink.numbers.size(); i++) {
+        CHECK(sink.numbers[i - 1] < sink.numbers[i]);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "bus.hh"
+#include "cpu/cpu.hh"
+#include "header.hh"
+#include <cstring>
+
+using namespace matar;
+
+// A machine running a program that turns on the display in mode 3 and a
+// timer, then keeps writing to VRAM, reached through a BIOS that does nothing
+// but jump to it.
+class Machine {
+  public:
+    explicit Machine(uint32_t seed                    = 0,
+                     std::unique_ptr<MemoryArena> arena = nullptr)
+      : bus(bios(), rom(seed), std::move(arena))
+      , cpu(bus) {}
+
+    // runs for at least this many cycles the way a frontend does, with the
+    // timer and the display going along through the scheduler
+    void run(uint64_t cycles) { bus.run(cycles); }
+
+    Bus bus;
+    Cpu cpu;
+
+  private:
+    static std::array<uint8_t, Bus::BIOS_SIZE> bios() {
+        std::array<uint8_t, Bus::BIOS_SIZE> bios = {};
+        const uint32_t trampoline[] = { 0xE59FF000, 0, 0x08000000 };
+        std::memcpy(bios.data(), trampoline, sizeof(trampoline));
+        return bios;
+    }
+
+    static std::vector<uint8_t> rom(uint32_t seed) {
+        const uint32_t program[] = {
+            0xE3A00301, // mov r0, #0x04000000
+            0xE3A01003, // mov r1, #3
+            0xE3811B01, // orr r1, r1, #0x400
+            0xE1C010B0, // strh r1, [r0]
+            0xE3A02502, // mov r2, #0x00800000
+            0xE2803C01, // add r3, r0, #0x100
+            0xE5832000, // str r2, [r3]
+            0xE3A04406, // mov r4, #0x06000000
+            0xE0C450B2, // strh r5, [r4], #2
+            0xE2855007, // add r5, r5, #7
+            0xE3C44801, // bic r4, r4, #0x10000
+            0xEAFFFFFB, // b 0x08000020
+        };
+
+        std::vector<uint8_t> rom(Header::HEADER_SIZE);
+        std::memcpy(rom.data(), program, sizeof(program));
+        /* past the program, only to tell ROMs apart */
+        std::memcpy(rom.data() + sizeof(program), &seed, sizeof(seed));
+        return rom;
+    }
+};
@@ -0,0 +1,91 @@
+#include "machine.hh"
+#include "rewind.hh"
+#include "savestate.hh"
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+
+#define TAG "[rewind]"
+
+// cycles standing in for a frame, the program writes to VRAM all along
+static constexpr uint64_t CYCLES = 20'000;
+
+// a slot for every capture a test makes, so that none is dropped however far
+// behind the thread compressing them falls
+static constexpr uint32_t DEPTH = 32;
+
+TEST_CASE("rewinding goes back to the states captured", TAG) {
+    Machine machine;
+    Rewind rewind(machine.bus, machine.cpu, { .interval = 2, .depth = DEPTH });
+    std::vector<std::vector<uint8_t>> captured;
+
+    CHECK_THROWS_AS(rewind.restore(), std::out_of_range);
+
+    for (int frame = 1; frame <= 20; frame++) {
+        machine.run(CYCLES);
+        rewind.frame();
+
+        if (frame % 2 == 0) {
+            captured.push_back(save_state(machine.bus, machine.cpu));
+        }
+    }
+
+    rewind.restore();
+    REQUIRE(rewind.dropped() == 0);
+    CHECK(rewind.states() == 10);
+    CHECK(save_state(machine.bus, machine.cpu) == captured[9]);
+
+    rewind.restore(3);
+    CHECK(rewind.states() == 7);
+    CHECK(save_state(machine.bus, machine.cpu) == captured[6]);
+
+    CHECK_THROWS_AS(rewind.restore(7), std::out_of_range);
+
+    rewind.restore(6);
+    CHECK(rewind.states() == 1);
+    CHECK(save_state(machine.bus, machine.cpu) == captured[0]);
+
+    // and captures go on from there
+    machine.run(CYCLES * 2);
+    rewind.frame();
+    rewind.frame();
+    const auto after = save_state(machine.bus, machine.cpu);
+
+    machine.run(CYCLES);
+    rewind.restore();
+    REQUIRE(rewind.dropped() == 0);
+    CHECK(rewind.states() == 2);
+    CHECK(save_state(machine.bus, machine.cpu) == after);
+}
+
+TEST_CASE("rewinding forgets the oldest states past the budget", TAG) {
+    Machine machine;
+    Rewind rewind(machine.bus, machine.cpu, { .interval = 1, .depth = DEPTH });
+
+    machine.run(CYCLES);
+    rewind.frame();
+    rewind.restore();
+
+    /* the newest state and the slots the next ones are captured into */
+    const size_t whole = rewind.memory();
+    CHECK(whole >= (1 + DEPTH) * save_state(machine.bus, machine.cpu).size());
+
+    /* room for the whole state and a few deltas of changes to VRAM */
+    Rewind small(machine.bus,
+                 machine.cpu,
+                 { .interval = 1,
+                   .budget = whole + 64 * 1024,
+                   .depth = DEPTH });
+
+    for (int frame = 0; frame < 30; frame++) {
+        machine.run(CYCLES);
+        small.frame();
+    }
+
+    small.restore();
+    REQUIRE(small.dropped() == 0);
+    CHECK(small.memory() <= whole + 64 * 1024);
+    CHECK(small.states() > 1);
+    CHECK(small.states() < 30);
+}
+
+#undef TAG
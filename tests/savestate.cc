@@ -0,0 +1,262 @@
+#include "machine.hh"
+#include "savestate.hh"
+#include "util/hash.hh"
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <memory>
+#include <stdexcept>
+
+#define TAG "[savestate]"
+
+namespace {
+// keeps a copy of every frame
+class FrameCopies : public display::FrameSink {
+  public:
+    std::vector<std::vector<uint8_t>> frames;
+    uint32_t pitch = 0;
+
+    void consume(const display::Frame& frame) override {
+        frames.emplace_back(frame.pixels.begin(), frame.pixels.end());
+        pitch = frame.pitch;
+    }
+};
+
+// Turns the display over to a tiled background and an object, which the
+// program then keeps drawing tiles and maps for, so that rendering goes
+// through the tile, palette and object caches.
+void
+draw_tiles(Machine& machine) {
+    Bus& bus = machine.bus;
+
+    /* mode 0, BG0 and objects, objects mapped one dimensionally */
+    bus.write_halfword(0x4000000, 0x1140);
+    /* BG0 with its map at the top of the background VRAM */
+    bus.write_halfword(0x4000008, 0x1F00);
+
+    for (uint32_t i = 0; i < 0x400; i += 2) {
+        bus.write_halfword(0x5000000 + i, i * 37);
+    }
+
+    /* a 16x16 object at 8, 8 with tiles of its own */
+    for (uint32_t i = 0; i < 0x80; i += 4) {
+        bus.write_word(0x6010000 + i, 0x12345678 * i);
+    }
+
+    bus.write_halfword(0x7000000, 8);
+    bus.write_halfword(0x7000002, 8 | 1 << 14);
+    bus.write_halfword(0x7000004, 0);
+}
+}
+
+TEST_CASE("loaded state runs on as the saved one did", TAG) {
+    Machine machine;
+    machine.run(100'000);
+
+    const std::vector<uint8_t> saved = save_state(machine.bus, machine.cpu);
+
+    machine.run(300'000);
+    const std::vector<uint8_t> ran = save_state(machine.bus, machine.cpu);
+    CHECK(ran != saved);
+
+    SECTION("into the machine it was saved from") {
+        load_state(machine.bus, machine.cpu, saved);
+        CHECK(save_state(machine.bus, machine.cpu) == saved);
+
+        machine.run(300'000);
+        CHECK(save_state(machine.bus, machine.cpu) == ran);
+    }
+
+    SECTION("into a new machine") {
+        Machine other;
+        load_state(other.bus, other.cpu, saved);
+
+        other.run(300'000);
+        CHECK(save_state(other.bus, other.cpu) == ran);
+    }
+}
+
+TEST_CASE("machines run the same way save the same state", TAG) {
+    // nothing left uninitialised or padding finds its way into a state
+    auto first  = std::make_unique<Machine>();
+    auto second = std::make_unique<Machine>();
+
+    first->run(10'000);
+    second->run(10'000);
+
+    CHECK(save_state(first->bus, first->cpu) ==
+          save_state(second->bus, second->cpu));
+}
+
+TEST_CASE("loaded state runs for as many cycles as asked", TAG) {
+    Machine machine;
+    machine.run(100'000);
+
+    const std::vector<uint8_t> saved = save_state(machine.bus, machine.cpu);
+    const uint64_t start = machine.bus.get_cycles();
+
+    Machine other;
+    load_state(other.bus, other.cpu, saved);
+
+    // counted from the clock of the state, not from reset
+    const RunStats stats = other.bus.run(50'000);
+
+    CHECK(stats.cycles >= 50'000);
+    CHECK(other.bus.get_cycles() == start + stats.cycles);
+
+    machine.bus.run(50'000);
+    CHECK(save_state(other.bus, other.cpu) ==
+          save_state(machine.bus, machine.cpu));
+}
+
+TEST_CASE("loaded state renders the frames the saved one did", TAG) {
+    Machine machine;
+    machine.run(1'000);
+    draw_tiles(machine);
+
+    /* saved in the middle of a frame */
+    machine.bus.run_frame();
+    machine.run(100'000);
+
+    /* read before saving, reads through the bus take cycles */
+    const uint16_t line = machine.bus.read_halfword(0x4000006);
+    const std::vector<uint8_t> saved = save_state(machine.bus, machine.cpu);
+
+    FrameCopies rendered;
+    machine.bus.set_frame_sink(&rendered);
+    machine.bus.run_frame();
+    machine.bus.run_frame();
+    machine.bus.set_frame_sink(nullptr);
+
+    // lines drawn before the state was saved are not part of it, it only
+    // takes the frame it was saved in from the next line on
+    const size_t from = line < 160 ? (line + 1) * rendered.pitch : 0;
+
+    auto check = [&](Machine& loaded) {
+        FrameCopies copies;
+        loaded.bus.set_frame_sink(&copies);
+        loaded.bus.run_frame();
+        loaded.bus.run_frame();
+        loaded.bus.set_frame_sink(nullptr);
+
+        REQUIRE(copies.frames.size() == 2);
+        REQUIRE(rendered.frames.size() == 2);
+        CHECK(std::equal(copies.frames[0].begin() + from,
+                         copies.frames[0].end(),
+                         rendered.frames[0].begin() + from));
+        CHECK(copies.frames[1] == rendered.frames[1]);
+    };
+
+    SECTION("into the machine it was saved from") {
+        /* with caches full of memory that is not in the state */
+        for (uint32_t i = 0; i < 0x18000; i += 4) {
+            machine.bus.write_word(0x6000000 + i, i * 0x9E3779B1);
+        }
+
+        for (uint32_t i = 0; i < 0x400; i += 2) {
+            machine.bus.write_halfword(0x5000000 + i, ~i);
+        }
+
+        machine.bus.write_halfword(0x7000000, 100);
+        machine.bus.write_halfword(0x7000002, 100 | 1 << 14);
+        /* BG0 off, objects only */
+        machine.bus.write_halfword(0x4000000, 0x1040);
+        machine.bus.run_frame();
+
+        load_state(machine.bus, machine.cpu, saved);
+        check(machine);
+    }
+
+    SECTION("into a new machine") {
+        Machine other;
+        load_state(other.bus, other.cpu, saved);
+        check(other);
+    }
+}
+
+TEST_CASE("states leave the sound output to the machine loading them", TAG) {
+    Machine quiet;
+    quiet.bus.set_sound_output(false);
+    quiet.run(100'000);
+
+    const std::vector<uint8_t> saved = save_state(quiet.bus, quiet.cpu);
+
+    // samples are made again where there is output
+    Machine other;
+    load_state(other.bus, other.cpu, saved);
+    other.bus.set_sample_hashing(true);
+    other.run(100'000);
+    CHECK(other.bus.take_sample_hash() != 0);
+
+    // and not where there is none
+    quiet.run(100'000);
+    load_state(quiet.bus, quiet.cpu, saved);
+    quiet.bus.set_sample_hashing(true);
+    quiet.run(100'000);
+    CHECK(quiet.bus.take_sample_hash() == 0);
+}
+
+TEST_CASE("states that cannot be loaded are rejected", TAG) {
+    Machine machine;
+    machine.run(10'000);
+
+    std::vector<uint8_t> state = save_state(machine.bus, machine.cpu);
+    const std::vector<uint8_t> before = state;
+
+    SECTION("cut short") {
+        state.pop_back();
+    }
+
+    SECTION("corrupt") {
+        state[state.size() / 2] ^= 1;
+    }
+
+    SECTION("another version") {
+        state[8]++;
+    }
+
+    SECTION("another ROM") {
+        Machine other(1);
+        other.run(10'000);
+        state = save_state(other.bus, other.cpu);
+    }
+
+    /* states of the same ROM that only fail to load partway, once the
+     * machine has started to change */
+    auto from_elsewhere = [&](int64_t grow) {
+        Machine other;
+        other.run(50'000);
+        state = save_state(other.bus, other.cpu);
+
+        /* the size and the hash are kept right, only the body is off */
+        constexpr size_t HEADER = 32;
+        std::vector<uint8_t> body(state.begin() + HEADER, state.end() - 8);
+        body.resize(body.size() + grow);
+
+        const uint64_t size = body.size();
+        const uint64_t hash = hash::xxh64(body);
+
+        state.resize(HEADER);
+        std::memcpy(state.data() + HEADER - sizeof(size), &size, sizeof(size));
+        state.insert(state.end(), body.begin(), body.end());
+        state.resize(state.size() + sizeof(hash));
+        std::memcpy(state.data() + state.size() - sizeof(hash),
+                    &hash,
+                    sizeof(hash));
+    };
+
+    SECTION("laid out with less in it") {
+        from_elsewhere(-8);
+    }
+
+    SECTION("laid out with more in it") {
+        from_elsewhere(8);
+    }
+
+    CHECK_THROWS_AS(load_state(machine.bus, machine.cpu, state),
+                    std::invalid_argument);
+
+    // and the machine is left as it was
+    CHECK(save_state(machine.bus, machine.cpu) == before);
+}
+
+#undef TAG
@@ -0,0 +1,81 @@
+#include "scheduler.hh"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+#define TAG "[scheduler]"
+
+using namespace matar;
+
+TEST_CASE("timing wheel order", TAG) {
+    TimingWheel wheel;
+
+    wheel.push({ Task::Type::DISPLAY_HBLANK, 1006 });
+    wheel.push({ Task::Type::TIMER0_OVERFLOW, 0x10000 });
+    wheel.push({ Task::Type::DMA0_ACTIVATE, 3 });
+    wheel.push({ Task::Type::DMA1_ACTIVATE, 3 });
+
+    // same cycle tasks come out in the order they were scheduled
+    CHECK(wheel.top().type == Task::Type::DMA0_ACTIVATE);
+    wheel.pop();
+    CHECK(wheel.top().type == Task::Type::DMA1_ACTIVATE);
+    wheel.pop();
+    CHECK(wheel.top().cycles == 1006);
+    wheel.pop();
+
+    // far away tasks go through the overflow heap
+    CHECK(wheel.top().cycles == 0x10000);
+    wheel.pop();
+    CHECK(wheel.empty());
+}
+
+TEST_CASE("timing wheel past and wrapping tasks", TAG) {
+    TimingWheel wheel;
+
+    wheel.push({ Task::Type::DISPLAY_HDRAW, 5000 });
+    wheel.push({ Task::Type::DISPLAY_HBLANK, 4000 });
+    wheel.pop();
+
+    // behind the last popped task
+    wheel.push({ Task::Type::SAMPLE_PWM, 10 });
+    // wraps around the end of the wheel
+    wheel.push({ Task::Type::DMA2_ACTIVATE, 4000 + TimingWheel::SLOTS - 1 });
+
+    CHECK(wheel.top().cycles == 10);
+    wheel.pop();
+    CHECK(wheel.top().cycles == 5000);
+    wheel.pop();
+    CHECK(wheel.top().cycles == 4000 + TimingWheel::SLOTS - 1);
+    wheel.pop();
+    CHECK(wheel.empty());
+}
+
+TEST_CASE("timing wheel matches heap", TAG) {
+    HeapQueue heap;
+    TimingWheel wheel;
+    std::mt19937_64 rng(0x6d61746172);
+    std::uniform_int_distribution<uint64_t> delay(0, 0x20000);
+    uint64_t now = 0;
+
+    for (int i = 0; i < 100000; i++) {
+        if (heap.empty() || rng() % 3 != 0) {
+            // mostly near events, with a few far ones
+            uint64_t cycles = now + (rng() % 8 ? delay(rng) % 2048 : delay(rng));
+            heap.push({ Task::Type::SAMPLE_PWM, cycles });
+            wheel.push({ Task::Type::SAMPLE_PWM, cycles });
+            continue;
+        }
+
+        REQUIRE(wheel.top().cycles == heap.top().cycles);
+        now = heap.top().cycles;
+        heap.pop();
+        wheel.pop();
+    }
+
+    while (!heap.empty()) {
+        REQUIRE(wheel.top().cycles == heap.top().cycles);
+        heap.pop();
+        wheel.pop();
+    }
+
+    CHECK(wheel.empty());
+}
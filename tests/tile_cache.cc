@@ -0,0 +1,68 @@
+#include "io/display/tile_cache.hh"
+#include <catch2/catch_test_macros.hpp>
+
+#define TAG "[display][tile cache]"
+
+using namespace matar::display;
+
+TEST_CASE("4bpp tiles", TAG) {
+    std::array<uint8_t, 128> vram = {};
+    TileCache tiles(vram);
+
+    // second tile, row 1
+    vram[32 + 4] = 0x21;
+    vram[32 + 7] = 0xF3;
+
+    const uint8_t* row = tiles.row(32, ColorDepth::BPP4, false, 1);
+    CHECK(row[0] == 0x1);
+    CHECK(row[1] == 0x2);
+    CHECK(row[6] == 0x3);
+    CHECK(row[7] == 0xF);
+
+    row = tiles.row(32, ColorDepth::BPP4, true, 1);
+    CHECK(row[7] == 0x1);
+    CHECK(row[6] == 0x2);
+    CHECK(row[1] == 0x3);
+    CHECK(row[0] == 0xF);
+}
+
+TEST_CASE("8bpp tiles", TAG) {
+    std::array<uint8_t, 128> vram = {};
+    TileCache tiles(vram);
+
+    vram[32 + 8 * 5 + 2] = 0xAB;
+
+    // tiles may start at any 32 byte boundary
+    CHECK(tiles.row(32, ColorDepth::BPP8, false, 5)[2] == 0xAB);
+    CHECK(tiles.row(32, ColorDepth::BPP8, true, 5)[5] == 0xAB);
+
+    // the last tile runs past the end of VRAM
+    CHECK(tiles.row(96, ColorDepth::BPP8, false, 7)[0] == 0);
+
+    // as does a tile starting past the end
+    CHECK(tiles.row(128, ColorDepth::BPP8, false, 0)[0] == 0);
+}
+
+TEST_CASE("invalidation", TAG) {
+    std::array<uint8_t, 128> vram = {};
+    TileCache tiles(vram);
+
+    CHECK(tiles.row(0, ColorDepth::BPP4, false, 0)[0] == 0);
+    CHECK(tiles.row(0, ColorDepth::BPP8, false, 4)[0] == 0);
+
+    vram[0]  = 0x05;
+    vram[32] = 0x07;
+
+    // stale until told about the writes
+    CHECK(tiles.row(0, ColorDepth::BPP4, false, 0)[0] == 0);
+    CHECK(tiles.row(0, ColorDepth::BPP8, false, 4)[0] == 0);
+
+    tiles.invalidate(32);
+
+    // 8bpp tile 0 spans the write, 4bpp tile 0 does not
+    CHECK(tiles.row(0, ColorDepth::BPP4, false, 0)[0] == 0);
+    CHECK(tiles.row(0, ColorDepth::BPP8, false, 4)[0] == 0x07);
+
+    tiles.invalidate_all();
+    CHECK(tiles.row(0, ColorDepth::BPP4, false, 0)[0] == 0x5);
+}
@@ -0,0 +1,44 @@
+#include "util/deflate.hh"
+#include <catch2/catch_test_macros.hpp>
+#include <string_view>
+
+#define TAG "[util][deflate]"
+
+static std::span<const uint8_t>
+bytes(std::string_view string) {
+    return { reinterpret_cast<const uint8_t*>(string.data()), string.size() };
+}
+
+TEST_CASE("crc32", TAG) {
+    CHECK(deflate::crc32(bytes("123456789")) == 0xCBF43926);
+
+    // continued over a second part
+    CHECK(deflate::crc32(bytes("6789"), deflate::crc32(bytes("12345"))) ==
+          0xCBF43926);
+}
+
+TEST_CASE("adler32", TAG) {
+    CHECK(deflate::adler32(bytes("Wikipedia")) == 0x11E60398);
+}
+
+TEST_CASE("zlib empty", TAG) {
+    CHECK(deflate::zlib_compress({}) ==
+          std::vector<uint8_t>{
+            0x78, 0x01, 0x03, 0x00, 0x00, 0x00, 0x00, 0x01 });
+}
+
+TEST_CASE("zlib repeated bytes", TAG) {
+    // a literal followed by a match of 9 at a distance of 1
+    CHECK(deflate::zlib_compress(bytes("aaaaaaaaaa")) ==
+          std::vector<uint8_t>{
+            0x78, 0x01, 0x4B, 0x84, 0x03, 0x00, 0x14, 0xE1, 0x03, 0xCB });
+}
+
+TEST_CASE("deflate long runs", TAG) {
+    std::vector<uint8_t> data(64 * 1024, 0x55);
+
+    // runs of the longest match, a couple of bytes each
+    CHECK(deflate::compress(data).size() < data.size() / 100);
+}
+
+#undef TAG
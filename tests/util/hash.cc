@@ -0,0 +1,29 @@
+#include "util/hash.hh"
+#include <catch2/catch_test_macros.hpp>
+#include <string_view>
+
+#define TAG "[util][hash]"
+
+static uint64_t
+xxh64(std::string_view string) {
+    return hash::xxh64(
+      { reinterpret_cast<const uint8_t*>(string.data()), string.size() });
+}
+
+TEST_CASE("xxh64 short", TAG) {
+    CHECK(xxh64("") == 0xEF46DB3751D8E999);
+    CHECK(xxh64("abc") == 0x44BC2CF5AD770999);
+}
+
+TEST_CASE("xxh64 long", TAG) {
+    // more than one 32 byte stripe
+    CHECK(xxh64("Nobody inspects the spammish repetition") ==
+          0xFBCEA83C8A378BF1);
+}
+
+TEST_CASE("combine depends on order", TAG) {
+    CHECK(hash::combine(hash::combine(0, 1), 2) !=
+          hash::combine(hash::combine(0, 2), 1));
+}
+
+#undef TAG
@@ -0,0 +1,133 @@
+#include "util/log.hh"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define TAG "[util][log]"
+
+using matar::LogLevel;
+
+static std::string
+contents(std::FILE* file) {
+    std::string text;
+    char buffer[4096];
+
+    std::rewind(file);
+
+    while (size_t read = std::fread(buffer, 1, sizeof(buffer), file)) {
+        text.append(buffer, read);
+    }
+
+    return text;
+}
+
+TEST_CASE("messages come out in order after a flush", TAG) {
+    std::FILE* file = std::tmpfile();
+    logging::Logger logger(LogLevel::Debug, file);
+
+    logger.log("first {}", 1);
+    logger.log("second {}", 2);
+    logger.flush();
+
+    CHECK(contents(file) == "first 1\nsecond 2\n");
+
+    std::fclose(file);
+}
+
+TEST_CASE("levels above the one set are left out", TAG) {
+    std::FILE* file = std::tmpfile();
+    logging::Logger logger(LogLevel::Warn, file);
+
+    logger.debug("debug");
+    logger.info("info");
+    logger.warn("warn");
+    logger.error("error");
+    logger.flush();
+
+    std::string text = contents(file);
+
+    CHECK(text.find("debug") == std::string::npos);
+    CHECK(text.find("info") == std::string::npos);
+    CHECK(text.find("[WARN] warn\n") != std::string::npos);
+    CHECK(text.find("[ERROR] error\n") != std::string::npos);
+
+    CHECK(logger.enabled(LogLevel::Error));
+    CHECK(!logger.enabled(LogLevel::Info));
+
+    std::fclose(file);
+}
+
+TEST_CASE("long messages are cut short", TAG) {
+    std::FILE* file = std::tmpfile();
+    logging::Logger logger(LogLevel::Debug, file);
+
+    logger.log("{}", std::string(1000, 'x'));
+    logger.flush();
+
+    std::string text = contents(file);
+
+    CHECK(text.size() == logging::Logger::RECORD_SIZE);
+    CHECK(text.back() == '\n');
+
+    std::fclose(file);
+}
+
+TEST_CASE("every thread gets its messages written", TAG) {
+    static constexpr int THREADS  = 4;
+    static constexpr int MESSAGES = 100;
+
+    std::FILE* file = std::tmpfile();
+
+    {
+        logging::Logger logger(LogLevel::Debug, file);
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&logger, t]() {
+                for (int i = 0; i < MESSAGES; i++) {
+                    logger.log("{} {}", t, i);
+                }
+            });
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        /* the rest is written out as the logger goes away */
+    }
+
+    std::string text = contents(file);
+    std::vector<int> next(THREADS, 0);
+    size_t start = 0;
+
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        int t, i;
+
+        REQUIRE(end != std::string::npos);
+        REQUIRE(std::sscanf(text.c_str() + start, "%d %d", &t, &i) == 2);
+
+        /* each thread's own messages stay in order */
+        CHECK(i == next[t]++);
+        start = end + 1;
+    }
+
+    for (int t = 0; t < THREADS; t++) {
+        CHECK(next[t] == MESSAGES);
+    }
+
+    std::fclose(file);
+}
+
+TEST_CASE("levels compiled in", TAG) {
+    CHECK(logging::compiled(LogLevel::Off));
+    CHECK(logging::compiled(LogLevel::Error) ==
+          (LogLevel::LOG_LEVEL != LogLevel::Off));
+    CHECK(logging::compiled(LogLevel::Debug) ==
+          (LogLevel::LOG_LEVEL == LogLevel::Debug));
+}
+
+#undef TAG